@@ -6,8 +6,16 @@
 #include <string_view>
 #include <variant>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <cstddef>
 #include <utility>
+#include <initializer_list>
+#include <optional>
+#include <type_traits>
+#include <functional>
+#include <cstdio>
+#include <iosfwd>
 
 // [ { "name": 3 }, { "age": 4 }, [ 3, 5, 8 ], "String" ]
 
@@ -17,10 +25,110 @@ namespace jsxxn {
   typedef std::int64_t s64;
   typedef std::uint64_t u64;
 
+  // Every container and string in the DOM takes a std::pmr allocator. Values
+  // built by hand use the default (heap) resource, while values produced by
+  // jsxxn::Document are placed into the document's arena. See Document below.
+  typedef std::pmr::string JSONString;
   typedef std::variant<std::int64_t, double> JSONNumber;
-  typedef std::variant<std::nullptr_t, std::string, JSONNumber, bool> JSONLiteral;
-  typedef std::map<std::string, JSON, std::less<>> JSONObject;
-  typedef std::vector<JSON> JSONArray;
+  typedef std::variant<std::nullptr_t, JSONString, JSONNumber, bool> JSONLiteral;
+
+  /**
+   * An object container which keeps its members in one contiguous vector in
+   * insertion order, so objects keep their key order when round-tripping
+   * through parse and stringify.
+   *
+   * Lookups are a linear scan over the keys while the object is small (which
+   * most objects are). Once an object grows past INDEX_THRESHOLD members, an
+   * open-addressing hash index over the members is built and kept up to date
+   * on insertion.
+   *
+   * Keys are exposed as mutable through iterators only so that the members
+   * can live in a std::vector. Changing a key through an iterator is not
+   * supported and will break lookups.
+  */
+  class JSONFlatObject {
+    public:
+      typedef JSONString key_type;
+      typedef JSON mapped_type;
+      typedef std::pair<JSONString, JSON> value_type;
+      typedef std::pmr::vector<value_type> container_type;
+      typedef container_type::allocator_type allocator_type;
+      typedef container_type::size_type size_type;
+      typedef container_type::iterator iterator;
+      typedef container_type::const_iterator const_iterator;
+
+      static constexpr size_type INDEX_THRESHOLD = 16;
+
+      JSONFlatObject();
+      explicit JSONFlatObject(const allocator_type& alloc);
+      JSONFlatObject(std::initializer_list<value_type> init, const allocator_type& alloc = allocator_type());
+      JSONFlatObject(const JSONFlatObject& other);
+      JSONFlatObject(JSONFlatObject&& other) noexcept;
+      JSONFlatObject& operator=(const JSONFlatObject& other);
+      JSONFlatObject& operator=(JSONFlatObject&& other);
+      ~JSONFlatObject();
+
+      allocator_type get_allocator() const;
+
+      iterator begin();
+      const_iterator begin() const;
+      iterator end();
+      const_iterator end() const;
+
+      bool empty() const;
+      size_type size() const;
+      size_type max_size() const;
+      void clear();
+      void reserve(size_type n);
+
+      iterator find(std::string_view key);
+      const_iterator find(std::string_view key) const;
+      size_type count(std::string_view key) const;
+      bool contains(std::string_view key) const;
+      JSON& at(std::string_view key);
+      const JSON& at(std::string_view key) const;
+      JSON& operator[](std::string_view key);
+
+      /**
+       * Like std::map::emplace, does nothing and returns the existing member
+       * if key is already present.
+      */
+      template< class K, class V >
+      std::pair<iterator, bool> emplace(K&& key, V&& value);
+      std::pair<iterator, bool> emplace(JSONString&& key, JSON&& value);
+
+      /**
+       * Appends a member without checking whether key is already present,
+       * which the caller must have made sure it isn't
+      */
+      iterator append_unique(JSONString&& key, JSON&& value);
+      size_type erase(std::string_view key);
+
+    private:
+      container_type entries;
+      // open-addressing table of (member position + 1), 0 marks an empty
+      // slot. Null until the object grows past INDEX_THRESHOLD. Held as a
+      // bare pointer allocated from the entries' resource, rather than as
+      // another vector, to keep every JSON node (which is sized for its
+      // largest alternative) small.
+      size_type* index;
+      size_type index_slots;
+
+      size_type index_find(std::string_view key) const;
+      void index_insert(size_type pos);
+      void index_rebuild(size_type slots);
+      void index_copy(const JSONFlatObject& other);
+      void index_free();
+  };
+
+  // Define JSXXN_STD_MAP_OBJECT (the CMake option of the same name) to store
+  // objects in a sorted std::pmr::map instead of a JSONFlatObject.
+  #ifdef JSXXN_STD_MAP_OBJECT
+  typedef std::pmr::map<JSONString, JSON, std::less<>> JSONObject;
+  #else
+  typedef JSONFlatObject JSONObject;
+  #endif
+  typedef std::pmr::vector<JSON> JSONArray;
 
   typedef std::variant<JSONLiteral, JSONObject, JSONArray> JSONValue;
 
@@ -45,7 +153,7 @@ namespace jsxxn {
     NULLPTR
   };
 
-  JSXXNValueType json_number_get_xtype(const JSONNumber& num);
+  inline JSXXNValueType json_number_get_xtype(const JSONNumber& num);
   bool json_number_equals_deep(const JSONNumber& a, const JSONNumber& b);
   // equating JSONNumber's trivially is tricky, since equating doubles should
   // really be done with an epsilon value in mind
@@ -58,10 +166,10 @@ namespace jsxxn {
   std::string json_literal_serialize(const JSONLiteral& literal);
 
 
-  JSONValueType json_literal_get_type(const JSONLiteral& value);
-  JSXXNValueType json_literal_get_xtype(const JSONLiteral& value);
-  JSONValueType json_value_get_type(const JSONValue& value);
-  JSXXNValueType json_value_get_xtype(const JSONValue& value);
+  inline JSONValueType json_literal_get_type(const JSONLiteral& value);
+  inline JSXXNValueType json_literal_get_xtype(const JSONLiteral& value);
+  inline JSONValueType json_value_get_type(const JSONValue& value);
+  inline JSXXNValueType json_value_get_xtype(const JSONValue& value);
   
   JSONValueType jsxxnt_to_jsont(JSXXNValueType jsxnvt);
   const char* jsonvt_str(JSONValueType jvt);
@@ -74,8 +182,410 @@ namespace jsxxn {
 
   std::string stringify(const JSONValue& json);
   std::string prettify(const JSONValue& json);
+
+  /**
+   * A buffered output sink for the serializers.
+   *
+   * Output is gathered in a fixed-size staging buffer and handed to the sink
+   * whenever the buffer fills up, so that a document can be serialized
+   * straight into a file, socket, or stream without ever holding the whole
+   * text in memory.
+   *
+   * The destructor flushes whatever is still buffered, but can't report
+   * errors, so call flush() when done writing to find out whether the last
+   * of the output made it. Write errors are thrown as std::runtime_error.
+  */
+  class JSONWriter {
+    public:
+      typedef std::function<void(const char* data, std::size_t size)> Sink;
+      static constexpr std::size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+      explicit JSONWriter(Sink sink, std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+      explicit JSONWriter(std::FILE* file, std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+      explicit JSONWriter(std::ostream& stream, std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+      JSONWriter(const JSONWriter& other) = delete;
+      JSONWriter& operator=(const JSONWriter& other) = delete;
+      ~JSONWriter();
+
+      /**
+       * Writes to a POSIX file descriptor (or a Windows CRT one). The
+       * descriptor is not closed by the writer.
+      */
+      static JSONWriter to_fd(int fd, std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+      void put(char ch) {
+        if (this->used == this->capacity) this->flush();
+        this->buffer[this->used++] = ch;
+      }
+
+      void write(const char* data, std::size_t size);
+      void write(std::string_view str) { this->write(str.data(), str.size()); }
+      void fill(std::size_t count, char ch);
+      void flush();
+
+    private:
+      Sink sink;
+      std::unique_ptr<char[]> buffer;
+      std::size_t capacity;
+      std::size_t used;
+  };
+
+  void stringify(const JSONValue& json, JSONWriter& writer);
+  void prettify(const JSONValue& json, JSONWriter& writer);
+
+  // Append the serialized string or number onto output, like the
+  // serializers do internally
+  void json_string_serialize(std::string_view v, std::string& output);
+  void json_string_serialize(std::string_view v, JSONWriter& output);
+  void json_number_serialize(const JSONNumber& number, std::string& output);
+  void json_number_serialize(const JSONNumber& number, JSONWriter& output);
+
+  /**
+   * The exact number of bytes stringify(json) / prettify(json) produce,
+   * computed without building the output (strings are only scanned for
+   * characters to escape).
+  */
+  std::size_t stringify_size(const JSONValue& json);
+  std::size_t prettify_size(const JSONValue& json);
+
+  /**
+   * Writes the serialized tree into output, which must have room for
+   * stringify_size(json) / prettify_size(json) bytes, and returns the end of
+   * what was written. Nothing is null terminated.
+  */
+  char* stringify(const JSONValue& json, char* output);
+  char* prettify(const JSONValue& json, char* output);
+
+  /**
+   * Produces the same text as stringify(json), but serializes every array
+   * and object with at least min_parallel_size members in chunks across
+   * threads threads (0 picks std::thread::hardware_concurrency) and joins
+   * the chunks in order. Worth it for documents made of a few huge
+   * containers, such as a single array of millions of records.
+  */
+  std::string stringify_parallel(const JSONValue& json, unsigned int threads = 0,
+    std::size_t min_parallel_size = 4096);
+
+  /**
+   * Encodes json as MessagePack, a binary format with the same data model
+   * as JSON but no text to format or tokenize. Integers are written in the
+   * smallest form that fits them and doubles always as 64 bit floats, so
+   * parse_msgpack gives back exactly the same tree, int64_t/double
+   * distinction included.
+  */
+  std::string to_msgpack(const JSONValue& json);
+  void to_msgpack(const JSONValue& json, JSONWriter& writer);
+
+  /**
+   * Decodes a single MessagePack value. 32 bit floats become doubles and
+   * unsigned integers above INT64_MAX become doubles, as they would when
+   * parsing text. Map keys must be strings, and the binary and extension
+   * types have no JSON equivalent, so both are errors.
+  */
+  JSON parse_msgpack(std::string_view data);
+  JSON parse_msgpack(std::string_view data, std::pmr::memory_resource* resource);
+
   JSON parse(std::string_view str);
 
+  /**
+   * Parses str while allocating every node, key, and string of the resulting
+   * tree from resource. The caller must keep resource alive for as long as
+   * the returned JSON (or anything moved out of it) is in use.
+  */
+  JSON parse(std::string_view str, std::pmr::memory_resource* resource);
+
+  /**
+   * Parses str like parse(str), using up to threads threads (0 picks
+   * std::thread::hardware_concurrency) when str is a large top level array.
+   *
+   * A quick pass over the input finds where each element of the array
+   * starts and ends, then runs of elements are parsed on separate threads
+   * and joined in order. Any other input, and any input which turns out to
+   * be malformed, is parsed sequentially, so the result and any error thrown
+   * are the same as parse's.
+  */
+  JSON parse_parallel(std::string_view str, unsigned int threads = 0);
+
+  /**
+   * What kind of error a parse(str, error) ran into. The first group are
+   * malformed tokens, the second are well-formed tokens in the wrong place.
+  */
+  enum class ParseErrorCode {
+    NONE,
+
+    UNEXPECTED_CHARACTER,
+    INVALID_KEYWORD,
+    INVALID_COMMENT,
+    NUMBER_TOO_LARGE,
+    NUMBER_NO_INTEGER_PART,
+    NUMBER_LEADING_DECIMAL,
+    NUMBER_TRAILING_DECIMAL,
+    NUMBER_LEADING_ZEROS,
+    NUMBER_INVALID_EXPONENT,
+    NUMBER_MISSING_EXPONENT,
+    STRING_UNCLOSED,
+    STRING_CONTROL_CHARACTER,
+    STRING_INVALID_ESCAPE,
+    STRING_UNESCAPED_BACKSLASH,
+    STRING_INCOMPLETE_HEX,
+    STRING_INVALID_HEX,
+
+    EXPECTED_VALUE,
+    UNEXPECTED_EOF,
+    EXPECTED_KEY,
+    EXPECTED_COLON,
+    UNEXPECTED_ARRAY_TOKEN,
+    UNEXPECTED_OBJECT_TOKEN,
+    UNCLOSED_ARRAY,
+    UNCLOSED_OBJECT,
+    TRAILING_TOKENS,
+    MAX_NESTING_DEPTH
+  };
+
+  struct LexState;
+
+  /**
+   * The outcome of parse(str, error). Converts to true if the parse failed,
+   * in which case offset, line, and column (both 1-based) give where the
+   * malformed text or the offending token starts.
+   *
+   * Nothing is formatted when an error is found. message() builds the text
+   * parse(str) would have thrown from the input, so the input must still be
+   * alive when it's called.
+  */
+  class ParseError {
+    public:
+      ParseErrorCode code = ParseErrorCode::NONE;
+      std::size_t offset = 0;
+      std::size_t line = 0;
+      std::size_t column = 0;
+
+      explicit operator bool() const { return this->code != ParseErrorCode::NONE; }
+      std::string message() const;
+
+    private:
+      friend ParseError parse_error(const LexState& ls);
+
+      std::string_view input;
+      std::size_t start = 0; // the positions message() quotes the input between
+      std::size_t end = 0;
+  };
+
+  /**
+   * Parses str like parse(str), except that malformed input is reported
+   * through error instead of by throwing. Returns null if str is malformed.
+  */
+  JSON parse(std::string_view str, ParseError& error);
+  JSON parse(std::string_view str, std::pmr::memory_resource* resource, ParseError& error);
+
+  /**
+   * The outcome of validate(). If the input is invalid, error tells where
+   * and why, with its message() being the one parse() would have thrown.
+  */
+  struct JSONValidation {
+    bool valid = true;
+    ParseError error;
+
+    explicit operator bool() const { return this->valid; }
+  };
+
+  /**
+   * Checks whether str is a single well-formed JSON value without building
+   * it. Follows the same grammar as parse and reports the same errors, but
+   * strings are only checked, never copied or unescaped, and nothing is
+   * allocated or thrown, even if str is invalid.
+  */
+  JSONValidation validate(std::string_view str);
+
+  struct ShapeCacheState;
+
+  /**
+   * Remembers the shapes of the objects parsed so far: for each key, which
+   * key followed it and which key started its value last time, and how many
+   * members that value had. Passing the same cache to many parses of records
+   * with a fixed schema (such as one per line of a log) lets the parser
+   * match nearly every key with one comparison instead of a lookup, check
+   * for duplicate keys by comparing small integer ids, and size each
+   * object's member list up front.
+   *
+   * The cache only speeds up building objects. It doesn't intern keys: every
+   * object still owns its keys, and the cache keeps one copy of each
+   * distinct key for itself. A cache must not be used by two parses at once.
+  */
+  class JSONShapeCache {
+    public:
+      JSONShapeCache();
+      JSONShapeCache(JSONShapeCache&& other) noexcept;
+      JSONShapeCache& operator=(JSONShapeCache&& other) noexcept;
+      JSONShapeCache(const JSONShapeCache& other) = delete;
+      JSONShapeCache& operator=(const JSONShapeCache& other) = delete;
+      ~JSONShapeCache();
+
+      std::size_t size() const; // number of distinct keys
+      void clear();
+
+    private:
+      friend ShapeCacheState& shape_cache_state(JSONShapeCache& cache);
+      std::unique_ptr<ShapeCacheState> state;
+  };
+
+  /**
+   * parse(str, resource), predicting the shapes of objects from (and adding
+   * to) the ones already in shapes
+  */
+  JSON parse(std::string_view str, std::pmr::memory_resource* resource, JSONShapeCache& shapes);
+
+  /**
+   * Receives the values of a JSON text one event at a time, in document
+   * order, from parse(str, handler). Override only the events you need, the
+   * rest do nothing.
+   *
+   * Object members are reported as on_key followed by the events of the
+   * member's value. String views passed to on_key and on_string are only
+   * valid until the callback returns.
+  */
+  class JSONHandler {
+    public:
+      virtual ~JSONHandler() = default;
+
+      virtual void on_null() {}
+      virtual void on_bool(bool value) { (void)value; }
+      virtual void on_number(JSONNumber value) { (void)value; }
+      virtual void on_string(std::string_view value) { (void)value; }
+      virtual void on_key(std::string_view key) { (void)key; }
+      virtual void on_start_object() {}
+      virtual void on_end_object() {}
+      virtual void on_start_array() {}
+      virtual void on_end_array() {}
+  };
+
+  /**
+   * Parses str without building a tree, reporting every value to handler as
+   * it is read. Malformed input throws the same std::runtime_error as
+   * parse(str) would, though handler may have already seen the events of
+   * everything before the error.
+  */
+  void parse(std::string_view str, JSONHandler& handler);
+
+  struct PushParserState;
+
+  /**
+   * A parser which is handed its input a piece at a time, for reading from
+   * sockets, pipes, and files too big to hold in memory.
+   *
+   * Chunks may be split anywhere, including inside of strings, numbers, and
+   * escape sequences. Events are sent to the handler as soon as each value
+   * is complete, and only the unfinished token at the end of a chunk is kept
+   * around between calls to feed, so memory use is bounded by the largest
+   * single token rather than by the size of the document.
+   *
+   * By default exactly one value is expected, like parse. With
+   * multiple_values set, any number of whitespace separated values are read
+   * one after another (as in NDJSON or concatenated JSON streams).
+   *
+   * Errors are thrown as std::runtime_error, as soon as they are seen. The
+   * parser can not be used anymore after an error.
+  */
+  class PushParser {
+    public:
+      explicit PushParser(JSONHandler& handler, bool multiple_values = false);
+      PushParser(const PushParser& other) = delete;
+      PushParser& operator=(const PushParser& other) = delete;
+      ~PushParser();
+
+      void feed(std::string_view chunk);
+
+      /**
+       * Marks the end of the input, flushing the last token and throwing if
+       * the input ended in the middle of a value.
+      */
+      void finish();
+
+    private:
+      std::unique_ptr<PushParserState> state;
+  };
+
+  struct JSONReaderState;
+
+  /**
+   * A pull parser, which reads one value at a time from str as the caller
+   * asks for it, without building a tree. Objects are walked with
+   * begin_object and next_key, and arrays with begin_array and
+   * next_element:
+   *
+   *   reader.begin_object();
+   *   std::string_view key;
+   *   while (reader.next_key(key)) {
+   *     if (key == "id") id = std::get<std::int64_t>(reader.read_number());
+   *     else reader.skip();
+   *   }
+   *
+   * Malformed input throws the same std::runtime_error as parse(str) would.
+   * Asking for a value of one type when the input holds another also throws
+   * a std::runtime_error. This is what the bindings in jsxxn_reflect.h
+   * decode with.
+  */
+  class JSONReader {
+    public:
+      explicit JSONReader(std::string_view str);
+      JSONReader(const JSONReader& other) = delete;
+      JSONReader& operator=(const JSONReader& other) = delete;
+      ~JSONReader();
+
+      /**
+       * Type of the next value, without reading it
+      */
+      JSONValueType peek() const;
+
+      void read_null();
+      bool read_bool();
+      JSONNumber read_number();
+
+      /**
+       * Also sets text to the number as written in the input, for reading
+       * it into types a JSONNumber can't hold exactly (such as integers
+       * past INT64_MAX)
+      */
+      JSONNumber read_number(std::string_view& text);
+
+      /**
+       * The returned view is only valid until the next call on the reader
+      */
+      std::string_view read_string();
+
+      /**
+       * Skips over the next value (checking that it's well formed), and
+       * returns its text from the input
+      */
+      std::string_view read_raw();
+      void skip();
+
+      void begin_object();
+
+      /**
+       * Reads the key of the next member into key, or returns false after
+       * reading the closing brace. key is only valid until the next call on
+       * the reader.
+      */
+      bool next_key(std::string_view& key);
+
+      void begin_array();
+
+      /**
+       * Returns true if another element follows (to be read next), or
+       * false after reading the closing bracket
+      */
+      bool next_element();
+
+      /**
+       * Throws if anything other than whitespace is left in the input
+      */
+      void finish();
+
+    private:
+      std::unique_ptr<JSONReaderState> state;
+  };
+
   class JSON {
     public:
       JSONValue value;
@@ -93,7 +603,8 @@ namespace jsxxn {
       JSON(const char* value);
       JSON(std::string_view value);
       explicit JSON(const std::string& value);
-      explicit JSON(std::string&& value);
+      explicit JSON(const JSONString& value);
+      explicit JSON(JSONString&& value);
       explicit JSON(JSONNumber value);
       explicit JSON(const JSONLiteral& value);
       explicit JSON(JSONLiteral&& value);
@@ -102,7 +613,9 @@ namespace jsxxn {
       JSON(const JSONObject& value);
       JSON(JSONObject&& value);
       JSON(const JSON& value);
-      JSON(JSON&& value);
+      // noexcept so that growing a JSONArray or JSONObject relocates its
+      // members by moving instead of deep copying them
+      JSON(JSON&& value) noexcept;
 
       // explicit to be unambiguous with const JSON& and JSON&&
       explicit JSON(const JSONValue& value);
@@ -110,8 +623,8 @@ namespace jsxxn {
 
       bool equals_deep(const JSON& other) const;
       
-      JSONValueType type() const;
-      JSXXNValueType xtype() const;
+      JSONValueType type() const { return json_value_get_type(this->value); }
+      JSXXNValueType xtype() const { return json_value_get_xtype(this->value); }
 
       JSON& operator=(const JSON& other);
       JSON& operator=(JSON&& other);
@@ -130,8 +643,8 @@ namespace jsxxn {
       explicit operator std::int64_t() const;
       operator JSONNumber() const;
       explicit operator std::nullptr_t() const;
-      explicit operator std::string&();
-      explicit operator const std::string& () const;
+      explicit operator JSONString&();
+      explicit operator const JSONString& () const;
       operator JSONLiteral&();
       operator const JSONLiteral&() const;
       operator JSONValue&();
@@ -179,7 +692,7 @@ namespace jsxxn {
       // Object Methods
       JSONObject::size_type count(std::string_view key) const;
       bool contains(std::string_view key) const;
-      JSON& operator[](const std::string& key);
+      JSON& operator[](std::string_view key);
       JSON& at(std::string_view key);
       const JSON& at(std::string_view key) const;
       
@@ -187,6 +700,491 @@ namespace jsxxn {
       std::pair<JSONObject::iterator, bool> emplace(Args&&... args);
       
   };
+
+  /**
+   * A parsed JSON tree which owns all of its memory.
+   *
+   * Every array, object, key, and string of the tree is bump-allocated out of
+   * a single monotonic arena owned by the document, so parsing does not go
+   * through malloc once per node, and destroying the document hands all of
+   * its memory back at once instead of freeing each node separately.
+   *
+   * Values inside of the document can be read and modified like any other
+   * JSON. Copies taken out of a document (JSON copy = doc.root()) are
+   * allocated on the heap and are safe to outlive it, but values *moved* out
+   * of a document still point into its arena and must not outlive it.
+  */
+  class Document {
+    public:
+      Document();
+      explicit Document(std::string_view str);
+      Document(const Document& other) = delete;
+      Document(Document&& other) = default;
+      Document& operator=(const Document& other) = delete;
+      Document& operator=(Document&& other);
+
+      JSON& root();
+      const JSON& root() const;
+      std::pmr::memory_resource* resource() const;
+
+    private:
+      // the arena must be declared before the root so that the root is
+      // destroyed first
+      std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+      JSON m_root;
+  };
+
+  /**
+   * A value inside of a LazyDocument, which is only a position in the
+   * document's text. Nothing under it is decoded until asked for.
+  */
+  class LazyValue {
+    public:
+      JSONValueType type() const;
+
+      /**
+       * Looks up a member or element by walking the container's text, and
+       * skipping over the values before it without decoding them
+      */
+      LazyValue at(std::string_view key) const;
+      LazyValue at(std::size_t idx) const;
+      bool contains(std::string_view key) const;
+      std::size_t size() const;
+
+      /**
+       * The text of this value, exactly as it appears in the document
+      */
+      std::string_view raw() const;
+
+      /**
+       * Fully parses (and so validates) this value into a JSON tree
+      */
+      JSON parse() const;
+
+    private:
+      friend class LazyDocument;
+      friend LazyValue lazy_value(std::string_view str, std::size_t start);
+      LazyValue(std::string_view str, std::size_t start);
+
+      std::string_view str; // the whole document
+      std::size_t start; // first character of this value in str
+  };
+
+  /**
+   * An on-demand view of a JSON document, for reading a few values out of a
+   * large document without parsing all of it.
+   *
+   * Navigating with at() tokenizes only the keys and separators of the
+   * containers on the way to the value. Every value passed over on the way
+   * is skipped by matching brackets, with strings jumped over by the
+   * vectorized string scan, and is never decoded or allocated. Only the
+   * values that are parse()d are fully checked: malformed input elsewhere
+   * is only noticed if a lookup has to pass through it.
+   *
+   * The document doesn't copy str, which must outlive it and every
+   * LazyValue taken from it.
+  */
+  class LazyDocument {
+    public:
+      explicit LazyDocument(std::string_view str);
+
+      LazyValue root() const;
+      LazyValue at(std::string_view key) const { return this->root().at(key); }
+      LazyValue at(std::size_t idx) const { return this->root().at(idx); }
+
+    private:
+      std::string_view str;
+      std::size_t start;
+  };
+
+  struct ViewData;
+  class ViewValue;
+
+  /**
+   * Walks the members of an object or the elements of an array of a
+   * ViewDocument, in their original order. key() may only be used on object
+   * members.
+  */
+  class ViewIterator {
+    public:
+      std::string_view key() const;
+      ViewValue value() const;
+      ViewValue operator*() const;
+      ViewIterator& operator++();
+      bool operator==(const ViewIterator& other) const { return this->pos == other.pos; }
+      bool operator!=(const ViewIterator& other) const { return this->pos != other.pos; }
+
+    private:
+      friend class ViewValue;
+      ViewIterator(const ViewData* data, std::size_t pos, bool is_object);
+
+      const ViewData* data;
+      std::size_t pos; // node of the current member's key, or of the current element
+      bool is_object;
+  };
+
+  /**
+   * A read-only value of a ViewDocument, read with the same names the JSON
+   * API uses. Strings are views, see ViewDocument.
+   *
+   * Members and elements are found by hopping from one to the next without
+   * visiting anything inside of them. at(key) looks key up once among the
+   * document's distinct keys, then matches members by pointer rather than
+   * by comparing strings. Repeated keys are all kept, and at() finds the
+   * first one, like the JSON an object parses into.
+  */
+  class ViewValue {
+    public:
+      JSONValueType type() const;
+      JSXXNValueType xtype() const;
+
+      explicit operator bool() const;
+      explicit operator double() const;
+      explicit operator std::int64_t() const;
+      explicit operator std::string_view() const;
+
+      ViewValue at(std::string_view key) const;
+      ViewValue at(std::size_t idx) const;
+      bool contains(std::string_view key) const;
+      std::size_t size() const;
+
+      ViewIterator begin() const;
+      ViewIterator end() const;
+
+      /**
+       * Copies this value and everything under it out into a JSON tree
+      */
+      JSON to_json() const;
+
+    private:
+      friend class ViewDocument;
+      friend class ViewIterator;
+      ViewValue(const ViewData* data, std::size_t node);
+
+      const ViewData* data;
+      std::size_t node;
+  };
+
+  /**
+   * A parsed, read-only JSON tree whose strings and keys are views into the
+   * text it was parsed from, for input where building a JSON tree would
+   * spend most of its time copying strings.
+   *
+   * Strings and keys without escape sequences aren't copied at all. Only
+   * those with escapes are decoded, into memory owned by the document. Keys
+   * are interned: the document keeps one view of each distinct key, shared
+   * by every member with that key, so an escaped key is decoded only once
+   * however often it repeats. The whole text is checked while parsing, and
+   * malformed input throws the same errors as parse().
+   *
+   * A document made from a string_view doesn't copy it, so the text must
+   * outlive the document and every value and view read from it. One made
+   * from a std::string keeps the string for as long as it lives.
+  */
+  class ViewDocument {
+    public:
+      explicit ViewDocument(std::string_view str);
+      explicit ViewDocument(std::string&& str);
+      ViewDocument(const ViewDocument& other) = delete;
+      ViewDocument(ViewDocument&& other) noexcept;
+      ViewDocument& operator=(const ViewDocument& other) = delete;
+      ViewDocument& operator=(ViewDocument&& other) noexcept;
+      ~ViewDocument();
+
+      ViewValue root() const;
+      ViewValue at(std::string_view key) const { return this->root().at(key); }
+      ViewValue at(std::size_t idx) const { return this->root().at(idx); }
+
+    private:
+      void parse(std::string_view str);
+
+      // both are held by pointer so that views into them survive moves
+      std::unique_ptr<std::string> text; // the text, if the document keeps it
+      std::unique_ptr<ViewData> data; // the parsed tree, see view.cpp
+  };
+
+  /**
+   * Parses only the value which the JSON Pointer (RFC 6901) pointer refers
+   * to inside of the text json, such as "/header/id" or "/items/0". Like
+   * LazyDocument, everything else on the way is skipped by bracket matching
+   * rather than parsed, and malformed input is only noticed where the walk
+   * passes through it.
+   *
+   * Throws std::runtime_error if pointer is malformed or refers to nothing.
+  */
+  JSON extract(std::string_view json, std::string_view pointer);
+
+  /**
+   * Evaluates every pointer in a single walk over json, stopping as soon as
+   * all of them are found. Pointers which refer to nothing are left empty.
+  */
+  std::vector<std::optional<JSON>> extract(std::string_view json, const std::vector<std::string_view>& pointers);
+
+  /**
+   * A JSONHandler which assembles events back into JSON values, calling
+   * on_value with each top level value once it is complete. Pair it with a
+   * PushParser to get whole values out of a chunked stream.
+  */
+  class JSONBuilder : public JSONHandler {
+    public:
+      typedef std::function<void(JSON&& value)> ValueCallback;
+
+      explicit JSONBuilder(ValueCallback on_value,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+      void on_null() override;
+      void on_bool(bool value) override;
+      void on_number(JSONNumber value) override;
+      void on_string(std::string_view value) override;
+      void on_key(std::string_view key) override;
+      void on_start_object() override;
+      void on_end_object() override;
+      void on_start_array() override;
+      void on_end_array() override;
+
+    private:
+      ValueCallback on_value;
+      std::pmr::memory_resource* resource;
+      std::vector<JSON> open; // containers which have been started but not ended
+      std::vector<JSONString> keys; // key of the next member of every open object
+
+      void add(JSON&& value);
+  };
+
+  /**
+   * One line of a JSON Lines (NDJSON) buffer. Exactly one of value and error
+   * is meaningful: error is empty when the line parsed successfully.
+  */
+  struct NDJSONRecord {
+    std::size_t line; // 1-based line number in the buffer
+    JSON value;
+    std::string error;
+
+    bool ok() const { return this->error.empty(); }
+  };
+
+  /**
+   * Parses a JSON Lines (NDJSON) buffer, one JSON value per line, across
+   * threads worker threads (0 picks std::thread::hardware_concurrency).
+   *
+   * Records come back in the order of their lines. A malformed line does
+   * not stop the batch, it is reported through its record's error instead.
+   * Blank lines are skipped.
+  */
+  std::vector<NDJSONRecord> parse_ndjson(std::string_view str, unsigned int threads = 0);
+
+  /**
+   * A read-only view of a whole file, memory-mapped where the platform
+   * supports it (POSIX and Windows) and read into a buffer otherwise. Files
+   * which can't be mapped, such as pipes, are read to their end into a
+   * buffer as well.
+   *
+   * Mapping a file lets the parser read it straight out of the page cache
+   * without first copying it into heap memory. Keep the MappedFile alive for
+   * as long as any views into it are in use, such as the strings handed to a
+   * JSONHandler by parse(file.view(), handler).
+  */
+  class MappedFile {
+    public:
+      explicit MappedFile(const std::string& path);
+      MappedFile(const MappedFile& other) = delete;
+      MappedFile(MappedFile&& other) noexcept;
+      MappedFile& operator=(const MappedFile& other) = delete;
+      MappedFile& operator=(MappedFile&& other) noexcept;
+      ~MappedFile();
+
+      std::string_view view() const;
+
+    private:
+      const char* m_data;
+      std::size_t m_size;
+      bool mapped; // false if m_data is a new[]'d buffer instead
+
+      void release();
+  };
+
+  JSON parse_file(const std::string& path);
+  JSON parse_file(const std::string& path, std::pmr::memory_resource* resource);
+  void parse_file(const std::string& path, JSONHandler& handler);
+
+  /**
+   * Writes json as a tape: a flat, already parsed image of the tree which a
+   * TapeDocument reads in place, so that loading it again takes no parsing
+   * at all. Every node is a fixed-size record in document order, followed by
+   * lookup tables for large containers and a table of all string bytes
+   * (each distinct key is stored once).
+   *
+   * Tapes are written in the byte order of the machine writing them and are
+   * meant as a cache next to the JSON they came from, not as an interchange
+   * format. A TapeDocument refuses tapes from a machine of the other byte
+   * order or from a different version of the format.
+  */
+  std::string to_tape(const JSONValue& json);
+  void to_tape(const JSONValue& json, JSONWriter& writer);
+
+  /**
+   * Where a TapeDocument's sections are in memory, shared by every value
+   * read out of it
+  */
+  struct TapeData {
+    const char* nodes;
+    std::size_t node_count;
+    const char* index;
+    std::size_t index_count;
+    std::string_view strings;
+  };
+
+  class TapeValue;
+
+  /**
+   * Walks the members of an object or the elements of an array on a tape,
+   * in their original order. key() may only be used on object members.
+  */
+  class TapeIterator {
+    public:
+      std::string_view key() const;
+      TapeValue value() const;
+      TapeValue operator*() const;
+      TapeIterator& operator++();
+      bool operator==(const TapeIterator& other) const { return this->pos == other.pos; }
+      bool operator!=(const TapeIterator& other) const { return this->pos != other.pos; }
+
+    private:
+      friend class TapeValue;
+      TapeIterator(const TapeData& tape, std::size_t pos, bool is_object);
+
+      TapeData tape;
+      std::size_t pos; // node of the current member's key, or of the current element
+      bool is_object;
+  };
+
+  /**
+   * A read-only value on a tape, read with the same names the JSON API
+   * uses. Strings are views into the tape.
+   *
+   * Objects and arrays with at least 16 members have lookup tables, so
+   * at(key) is a binary search and at(idx) a single load. Smaller ones are
+   * walked, hopping from member to member without visiting anything inside
+   * of them.
+  */
+  class TapeValue {
+    public:
+      JSONValueType type() const;
+      JSXXNValueType xtype() const;
+
+      explicit operator bool() const;
+      explicit operator double() const;
+      explicit operator std::int64_t() const;
+      explicit operator std::string_view() const;
+
+      TapeValue at(std::string_view key) const;
+      TapeValue at(std::size_t idx) const;
+      bool contains(std::string_view key) const;
+      std::size_t size() const;
+
+      TapeIterator begin() const;
+      TapeIterator end() const;
+
+      /**
+       * Copies this value and everything under it out into a JSON tree
+      */
+      JSON to_json() const;
+
+    private:
+      friend class TapeDocument;
+      friend class TapeIterator;
+      TapeValue(const TapeData& tape, std::size_t node);
+
+      TapeData tape;
+      std::size_t node;
+  };
+
+  /**
+   * A tape written by to_tape, read in place.
+   *
+   * Opening a tape only checks its header, so it takes the same time
+   * whatever the size of the document. Nodes are bounds-checked as they are
+   * read, so a corrupt tape throws std::runtime_error rather than reading
+   * out of bounds, though it may read back wrong values.
+   *
+   * A TapeDocument made from a string_view doesn't copy it, so the data must
+   * outlive the document and every value read from it. One made by open()
+   * keeps its file mapped for as long as it lives.
+  */
+  class TapeDocument {
+    public:
+      explicit TapeDocument(std::string_view data);
+      static TapeDocument open(const std::string& path);
+
+      TapeValue root() const;
+      TapeValue at(std::string_view key) const { return this->root().at(key); }
+      TapeValue at(std::size_t idx) const { return this->root().at(idx); }
+
+    private:
+      std::unique_ptr<MappedFile> file;
+      TapeData tape;
+  };
+
+  // The type functions below are called on nearly every access through the
+  // JSON API, so they are inline and switch on the variant indices directly
+  // rather than going through std::visit. The case labels follow the order
+  // of the alternatives in JSONNumber, JSONLiteral, and JSONValue.
+  static_assert(std::variant_size_v<JSONNumber> == 2);
+  static_assert(std::is_same_v<std::variant_alternative_t<0, JSONNumber>, std::int64_t>);
+  static_assert(std::is_same_v<std::variant_alternative_t<1, JSONNumber>, double>);
+  static_assert(std::variant_size_v<JSONLiteral> == 4);
+  static_assert(std::is_same_v<std::variant_alternative_t<0, JSONLiteral>, std::nullptr_t>);
+  static_assert(std::is_same_v<std::variant_alternative_t<1, JSONLiteral>, JSONString>);
+  static_assert(std::is_same_v<std::variant_alternative_t<2, JSONLiteral>, JSONNumber>);
+  static_assert(std::is_same_v<std::variant_alternative_t<3, JSONLiteral>, bool>);
+  static_assert(std::variant_size_v<JSONValue> == 3);
+  static_assert(std::is_same_v<std::variant_alternative_t<0, JSONValue>, JSONLiteral>);
+  static_assert(std::is_same_v<std::variant_alternative_t<1, JSONValue>, JSONObject>);
+  static_assert(std::is_same_v<std::variant_alternative_t<2, JSONValue>, JSONArray>);
+
+  inline JSXXNValueType json_number_get_xtype(const JSONNumber& number) {
+    return number.index() == 0 ? JSXXNValueType::SINTEGER : JSXXNValueType::DOUBLE;
+  }
+
+  inline JSONValueType json_literal_get_type(const JSONLiteral& literal) {
+    switch (literal.index()) {
+      case 0: return JSONValueType::NULLPTR;
+      case 1: return JSONValueType::STRING;
+      case 2: return JSONValueType::NUMBER;
+      default: return JSONValueType::BOOLEAN;
+    }
+  }
+
+  inline JSXXNValueType json_literal_get_xtype(const JSONLiteral& literal) {
+    switch (literal.index()) {
+      case 0: return JSXXNValueType::NULLPTR;
+      case 1: return JSXXNValueType::STRING;
+      case 2: return json_number_get_xtype(*std::get_if<JSONNumber>(&literal));
+      default: return JSXXNValueType::BOOLEAN;
+    }
+  }
+
+  inline JSONValueType json_value_get_type(const JSONValue& value) {
+    switch (value.index()) {
+      case 0: return json_literal_get_type(*std::get_if<JSONLiteral>(&value));
+      case 1: return JSONValueType::OBJECT;
+      default: return JSONValueType::ARRAY;
+    }
+  }
+
+  inline JSXXNValueType json_value_get_xtype(const JSONValue& value) {
+    switch (value.index()) {
+      case 0: return json_literal_get_xtype(*std::get_if<JSONLiteral>(&value));
+      case 1: return JSXXNValueType::OBJECT;
+      default: return JSXXNValueType::ARRAY;
+    }
+  }
+
+  template< class K, class V >
+  std::pair<JSONFlatObject::iterator, bool> JSONFlatObject::emplace(K&& key, V&& value) {
+    return this->emplace(JSONString(std::forward<K>(key), this->get_allocator()),
+      JSON(std::forward<V>(value)));
+  }
 };
 
 #endif
\ No newline at end of file
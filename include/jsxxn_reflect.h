@@ -0,0 +1,344 @@
+#ifndef JSXXN_REFLECT_COBYJ33_H
+#define JSXXN_REFLECT_COBYJ33_H
+
+#include "jsxxn.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <limits>
+#include <charconv>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Binds JSON straight to and from C++ types, without building a JSON tree
+ * in between. Members of a struct are listed once with JSXXN_REFLECT, at
+ * namespace scope in the struct's own namespace:
+ *
+ *   struct Point { std::int64_t x; std::int64_t y; std::string label; };
+ *   JSXXN_REFLECT(Point, x, y, label)
+ *
+ *   Point p = jsxxn::bind_parse<Point>(R"({ "x": 1, "y": 2, "label": "a" })");
+ *   std::string text = jsxxn::bind_stringify(p);
+ *
+ * Supported member types are bool, integral and floating point types,
+ * std::string, std::vector, std::optional (null when empty),
+ * std::map<std::string, T>, jsxxn::JSON (for parts without a fixed shape),
+ * and other reflected structs, nested in any combination.
+ *
+ * Decoding walks a JSONReader. Each key is matched against the member names
+ * with comparisons against constants that are unrolled at compile time.
+ * Unknown keys are skipped, members whose key is missing are left as they
+ * were, and for a repeated key the first one wins (as in parse). A value of
+ * the wrong type, or an integer which doesn't fit its member, throws a
+ * std::runtime_error.
+*/
+
+#define JSXXN_REFLECT(Type, ...) \
+  [[maybe_unused]] constexpr auto jsxxn_reflect_fields(const Type*) { \
+    return std::make_tuple(JSXXN_IMPL_FOR_EACH(JSXXN_IMPL_REFLECT_FIELD, Type, __VA_ARGS__)); \
+  }
+
+#define JSXXN_IMPL_REFLECT_FIELD(Type, member) ::jsxxn::JSONField<Type, decltype(Type::member)>{ #member, &Type::member }
+
+// JSXXN_IMPL_FOR_EACH(m, t, a, b, ...) expands to m(t, a), m(t, b), ... for
+// up to 32 arguments
+#define JSXXN_IMPL_EXPAND(x) x
+#define JSXXN_IMPL_FE_1(m, t, a) m(t, a)
+#define JSXXN_IMPL_FE_2(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_1(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_3(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_2(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_4(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_3(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_5(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_4(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_6(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_5(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_7(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_6(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_8(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_7(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_9(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_8(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_10(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_9(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_11(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_10(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_12(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_11(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_13(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_12(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_14(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_13(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_15(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_14(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_16(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_15(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_17(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_16(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_18(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_17(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_19(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_18(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_20(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_19(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_21(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_20(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_22(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_21(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_23(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_22(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_24(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_23(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_25(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_24(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_26(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_25(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_27(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_26(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_28(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_27(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_29(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_28(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_30(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_29(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_31(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_30(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_32(m, t, a, ...) m(t, a), JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_31(m, t, __VA_ARGS__))
+#define JSXXN_IMPL_FE_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, NAME, ...) NAME
+#define JSXXN_IMPL_FOR_EACH(m, t, ...) \
+  JSXXN_IMPL_EXPAND(JSXXN_IMPL_FE_PICK(__VA_ARGS__, \
+    JSXXN_IMPL_FE_32, JSXXN_IMPL_FE_31, JSXXN_IMPL_FE_30, JSXXN_IMPL_FE_29, \
+    JSXXN_IMPL_FE_28, JSXXN_IMPL_FE_27, JSXXN_IMPL_FE_26, JSXXN_IMPL_FE_25, \
+    JSXXN_IMPL_FE_24, JSXXN_IMPL_FE_23, JSXXN_IMPL_FE_22, JSXXN_IMPL_FE_21, \
+    JSXXN_IMPL_FE_20, JSXXN_IMPL_FE_19, JSXXN_IMPL_FE_18, JSXXN_IMPL_FE_17, \
+    JSXXN_IMPL_FE_16, JSXXN_IMPL_FE_15, JSXXN_IMPL_FE_14, JSXXN_IMPL_FE_13, \
+    JSXXN_IMPL_FE_12, JSXXN_IMPL_FE_11, JSXXN_IMPL_FE_10, JSXXN_IMPL_FE_9, \
+    JSXXN_IMPL_FE_8, JSXXN_IMPL_FE_7, JSXXN_IMPL_FE_6, JSXXN_IMPL_FE_5, \
+    JSXXN_IMPL_FE_4, JSXXN_IMPL_FE_3, JSXXN_IMPL_FE_2, JSXXN_IMPL_FE_1)(m, t, __VA_ARGS__))
+
+namespace jsxxn {
+
+  template<class Class, class Member>
+  struct JSONField {
+    std::string_view name;
+    Member Class::* member;
+  };
+
+  template<class T, class = void>
+  struct bind_is_reflected : std::false_type {};
+
+  template<class T>
+  struct bind_is_reflected<T, std::void_t<decltype(jsxxn_reflect_fields(static_cast<const T*>(nullptr)))>> :
+    std::true_type {};
+
+  template<class T> struct bind_is_string : std::false_type {};
+  template<class Traits, class Alloc>
+  struct bind_is_string<std::basic_string<char, Traits, Alloc>> : std::true_type {};
+
+  template<class T> struct bind_is_vector : std::false_type {};
+  template<class T, class Alloc>
+  struct bind_is_vector<std::vector<T, Alloc>> : std::true_type {};
+
+  template<class T> struct bind_is_optional : std::false_type {};
+  template<class T>
+  struct bind_is_optional<std::optional<T>> : std::true_type {};
+
+  template<class T> struct bind_is_string_map : std::false_type {};
+  template<class T, class Compare, class Alloc>
+  struct bind_is_string_map<std::map<std::string, T, Compare, Alloc>> : std::true_type {};
+
+  template<class T> struct bind_unsupported : std::false_type {};
+
+  template<class T> void bind_read(JSONReader& reader, T& out);
+
+  /**
+   * Integers are read from their text when it's a plain integer, so that
+   * the whole range of T is accepted (a JSONNumber only holds integers up to
+   * INT64_MAX, which cuts off half of std::uint64_t). Anything else, such as
+   * 2.0 or 1e3, goes through number.
+  */
+  template<class T>
+  T bind_int_cast(const JSONNumber& number, std::string_view text) {
+    T parsed;
+    const char* end = text.data() + text.size();
+    std::from_chars_result res = std::from_chars(text.data(), end, parsed);
+    if (res.ptr == end && res.ec == std::errc())
+      return parsed;
+    if (res.ptr == end && res.ec == std::errc::result_out_of_range)
+      throw std::runtime_error("[jsxxn::bind_read] integer " + std::string(text) + " out of range");
+
+    std::int64_t value;
+    if (const std::int64_t* integer = std::get_if<std::int64_t>(&number)) {
+      value = *integer;
+    } else {
+      // only doubles which hold a whole number within range are accepted
+      const double d = std::get<double>(number);
+      if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0) || d != static_cast<double>(static_cast<std::int64_t>(d)))
+        throw std::runtime_error("[jsxxn::bind_read] expected an integer, got " + json_number_serialize(number));
+      value = static_cast<std::int64_t>(d);
+    }
+
+    bool fits;
+    if constexpr (std::is_signed_v<T>)
+      fits = value >= static_cast<std::int64_t>(std::numeric_limits<T>::min()) &&
+        value <= static_cast<std::int64_t>(std::numeric_limits<T>::max());
+    else
+      fits = value >= 0 && static_cast<std::uint64_t>(value) <= std::numeric_limits<T>::max();
+    if (!fits)
+      throw std::runtime_error("[jsxxn::bind_read] integer " + std::to_string(value) + " out of range");
+    return static_cast<T>(value);
+  }
+
+  /**
+   * Reads the value of a member unless the same key was already read, in
+   * which case it's skipped
+  */
+  template<class T>
+  void bind_read_member(JSONReader& reader, T& out, bool& seen) {
+    if (seen) {
+      reader.skip();
+      return;
+    }
+    seen = true;
+    bind_read(reader, out);
+  }
+
+  template<class T, class Fields, std::size_t... I>
+  bool bind_read_field(JSONReader& reader, T& out, std::string_view key, const Fields& fields,
+    bool* seen, std::index_sequence<I...>) {
+    return ((key == std::get<I>(fields).name &&
+      (bind_read_member(reader, out.*(std::get<I>(fields).member), seen[I]), true)) || ...);
+  }
+
+  template<class T>
+  void bind_read(JSONReader& reader, T& out) {
+    if constexpr (std::is_same_v<T, bool>) {
+      out = reader.read_bool();
+    } else if constexpr (std::is_integral_v<T>) {
+      std::string_view text;
+      const JSONNumber number = reader.read_number(text);
+      out = bind_int_cast<T>(number, text);
+    } else if constexpr (std::is_floating_point_v<T>) {
+      const JSONNumber number = reader.read_number();
+      const std::int64_t* integer = std::get_if<std::int64_t>(&number);
+      out = static_cast<T>(integer != nullptr ? static_cast<double>(*integer) : std::get<double>(number));
+    } else if constexpr (bind_is_string<T>::value) {
+      out.assign(reader.read_string());
+    } else if constexpr (std::is_same_v<T, JSON>) {
+      out = parse(reader.read_raw());
+    } else if constexpr (bind_is_optional<T>::value) {
+      if (reader.peek() == JSONValueType::NULLPTR) {
+        reader.read_null();
+        out.reset();
+      } else {
+        if (!out.has_value()) out.emplace();
+        bind_read(reader, *out);
+      }
+    } else if constexpr (bind_is_vector<T>::value) {
+      out.clear();
+      reader.begin_array();
+      while (reader.next_element())
+        bind_read(reader, out.emplace_back());
+    } else if constexpr (bind_is_string_map<T>::value) {
+      out.clear();
+      reader.begin_object();
+      std::string_view key;
+      while (reader.next_key(key)) {
+        auto [it, inserted] = out.try_emplace(std::string(key));
+        if (inserted) bind_read(reader, it->second);
+        else reader.skip(); // first one wins
+      }
+    } else if constexpr (bind_is_reflected<T>::value) {
+      constexpr auto fields = jsxxn_reflect_fields(static_cast<const T*>(nullptr));
+      constexpr std::size_t count = std::tuple_size_v<std::remove_const_t<decltype(fields)>>;
+      bool seen[count] = {};
+
+      reader.begin_object();
+      std::string_view key;
+      while (reader.next_key(key)) {
+        if (!bind_read_field(reader, out, key, fields, seen, std::make_index_sequence<count>()))
+          reader.skip();
+      }
+    } else {
+      static_assert(bind_unsupported<T>::value, "type can't be bound to JSON, see jsxxn_reflect.h");
+    }
+  }
+
+  inline void bind_put(std::string& output, char ch) { output.push_back(ch); }
+  inline void bind_put(JSONWriter& output, char ch) { output.put(ch); }
+  inline void bind_write_raw(std::string& output, std::string_view str) { output.append(str.data(), str.size()); }
+  inline void bind_write_raw(JSONWriter& output, std::string_view str) { output.write(str); }
+  inline void bind_write_json(std::string& output, const JSON& json) { output += stringify(json.value); }
+  inline void bind_write_json(JSONWriter& output, const JSON& json) { stringify(json.value, output); }
+
+  template<class Output, class T> void bind_write(Output& output, const T& value);
+
+  template<class Output, class T, class Fields, std::size_t... I>
+  void bind_write_fields(Output& output, const T& value, const Fields& fields, std::index_sequence<I...>) {
+    // member names are identifiers, so they never need escaping
+    ((bind_put(output, I == 0 ? '{' : ','), bind_put(output, '"'),
+      bind_write_raw(output, std::get<I>(fields).name), bind_write_raw(output, "\":"),
+      bind_write(output, value.*(std::get<I>(fields).member))), ...);
+    bind_put(output, '}');
+  }
+
+  template<class Output, class T>
+  void bind_write(Output& output, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      bind_write_raw(output, value ? "true" : "false");
+    } else if constexpr (std::is_integral_v<T>) {
+      char buf[24];
+      std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), value);
+      bind_write_raw(output, std::string_view(buf, static_cast<std::size_t>(res.ptr - buf)));
+    } else if constexpr (std::is_floating_point_v<T>) {
+      json_number_serialize(JSONNumber(static_cast<double>(value)), output);
+    } else if constexpr (bind_is_string<T>::value) {
+      json_string_serialize(std::string_view(value), output);
+    } else if constexpr (std::is_same_v<T, JSON>) {
+      bind_write_json(output, value);
+    } else if constexpr (bind_is_optional<T>::value) {
+      if (value.has_value()) bind_write(output, *value);
+      else bind_write_raw(output, "null");
+    } else if constexpr (bind_is_vector<T>::value) {
+      bind_put(output, '[');
+      for (std::size_t i = 0; i < value.size(); i++) {
+        if (i > 0) bind_put(output, ',');
+        bind_write(output, value[i]);
+      }
+      bind_put(output, ']');
+    } else if constexpr (bind_is_string_map<T>::value) {
+      bind_put(output, '{');
+      bool first = true;
+      for (const auto& [key, member] : value) {
+        if (!first) bind_put(output, ',');
+        first = false;
+        json_string_serialize(key, output);
+        bind_put(output, ':');
+        bind_write(output, member);
+      }
+      bind_put(output, '}');
+    } else if constexpr (bind_is_reflected<T>::value) {
+      constexpr auto fields = jsxxn_reflect_fields(static_cast<const T*>(nullptr));
+      constexpr std::size_t count = std::tuple_size_v<std::remove_const_t<decltype(fields)>>;
+      bind_write_fields(output, value, fields, std::make_index_sequence<count>());
+    } else {
+      static_assert(bind_unsupported<T>::value, "type can't be bound to JSON, see jsxxn_reflect.h");
+    }
+  }
+
+  /**
+   * Decodes str into out, which must be a type supported by bind_read. Throws
+   * std::runtime_error on malformed input or a value that doesn't fit out.
+  */
+  template<class T>
+  void bind_parse(std::string_view str, T& out) {
+    JSONReader reader(str);
+    bind_read(reader, out);
+    reader.finish();
+  }
+
+  template<class T>
+  T bind_parse(std::string_view str) {
+    T out{};
+    bind_parse(str, out);
+    return out;
+  }
+
+  /**
+   * Same output as stringify would give for the equivalent JSON tree, with
+   * the members of structs in declaration order
+  */
+  template<class T>
+  std::string bind_stringify(const T& value) {
+    std::string output;
+    bind_write(output, value);
+    return output;
+  }
+
+  template<class T>
+  void bind_stringify(const T& value, JSONWriter& writer) {
+    bind_write(writer, value);
+  }
+
+};
+
+#endif
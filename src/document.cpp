@@ -0,0 +1,41 @@
+#include "jsxxn_impl.h"
+
+#include <memory_resource>
+#include <memory>
+#include <algorithm>
+#include <utility>
+
+namespace jsxxn {
+
+  /**
+   * A parsed tree usually takes up a few times the size of its source text,
+   * so the first arena block is sized off of the input to avoid walking
+   * through many small blocks on big documents.
+  */
+  constexpr std::size_t DOCUMENT_MIN_ARENA_BLOCK = 1024;
+
+  Document::Document() :
+    arena(std::make_unique<std::pmr::monotonic_buffer_resource>(DOCUMENT_MIN_ARENA_BLOCK)),
+    m_root() {}
+
+  Document::Document(std::string_view str) :
+    arena(std::make_unique<std::pmr::monotonic_buffer_resource>(
+      std::max(str.length(), DOCUMENT_MIN_ARENA_BLOCK))),
+    m_root(parse(str, arena.get())) {}
+
+  Document& Document::operator=(Document&& other) {
+    // the current tree has to be torn down while its arena is still alive
+    this->m_root = JSON();
+    this->arena = std::move(other.arena);
+    this->m_root = std::move(other.m_root);
+    return *this;
+  }
+
+  JSON& Document::root() { return this->m_root; }
+  const JSON& Document::root() const { return this->m_root; }
+
+  std::pmr::memory_resource* Document::resource() const {
+    return this->arena.get();
+  }
+
+};
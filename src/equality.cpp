@@ -12,10 +12,15 @@ namespace jsxxn {
       },
       [](const JSONObject& obj1, const JSONObject& obj2) {
         if (obj1.size() != obj2.size()) return false;
+        // objects parsed from the same schema list their keys in the same
+        // order, so the member in the same position is tried before a lookup
+        auto same_pos = obj2.begin();
         for (auto& entry : obj1) {
-          if (obj2.count(entry.first) == 0) return false;
-          if (!json_value_equals_deep(entry.second.value, obj2.at(entry.first).value))
+          auto other = same_pos->first == entry.first ? same_pos : obj2.find(entry.first);
+          if (other == obj2.end()) return false;
+          if (!json_value_equals_deep(entry.second.value, other->second.value))
             return false;
+          ++same_pos;
         }
         return true;
       },
@@ -66,7 +71,7 @@ namespace jsxxn {
       [](const bool a, const bool b) {
         return a == b;
       },
-      [](const std::string& a, const std::string& b) {
+      [](const JSONString& a, const JSONString& b) {
         return a == b;
       },
       [](const auto& a, const auto& b) {
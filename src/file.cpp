@@ -0,0 +1,253 @@
+#include "jsxxn.h"
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <fstream>
+#include <utility>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define JSXXN_MMAP_POSIX
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#elif defined(_WIN32)
+  #define JSXXN_MMAP_WIN32
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+#endif
+
+/**
+ * The tokenizer never reads past the end of the view it's given (the
+ * vectorized loops in scan.cpp finish the last partial block byte by byte),
+ * so mapped files need no padding after their last byte.
+*/
+
+namespace jsxxn {
+
+  std::string err_file_open(const std::string& path) {
+    return "[jsxxn::MappedFile] could not open file " + path;
+  }
+
+  std::string err_file_map(const std::string& path) {
+    return "[jsxxn::MappedFile] could not map file " + path;
+  }
+
+  std::string err_file_read(const std::string& path) {
+    return "[jsxxn::MappedFile] could not read file " + path;
+  }
+
+  #if defined(JSXXN_MMAP_POSIX)
+  /**
+   * Reads fd to its end into a new[]'d buffer, for files which can't be
+   * mapped since their size isn't known up front (pipes, FIFOs, and /proc
+   * files, which all report a size of 0). Returns false on a read error.
+  */
+  bool read_unmappable(int fd, const char*& data, std::size_t& size) {
+    std::size_t capacity = 1 << 16;
+    char* buffer = new char[capacity];
+    size = 0;
+
+    while (true) {
+      if (size == capacity) {
+        char* grown = new char[capacity * 2];
+        std::memcpy(grown, buffer, size);
+        delete[] buffer;
+        buffer = grown;
+        capacity *= 2;
+      }
+
+      ::ssize_t got = ::read(fd, buffer + size, capacity - size);
+      if (got == 0) break;
+      if (got == -1) {
+        if (errno == EINTR) continue;
+        delete[] buffer;
+        return false;
+      }
+      size += static_cast<std::size_t>(got);
+    }
+
+    data = buffer;
+    return true;
+  }
+
+  MappedFile::MappedFile(const std::string& path) : m_data(nullptr), m_size(0), mapped(false) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) throw std::runtime_error(err_file_open(path));
+
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+      ::close(fd);
+      throw std::runtime_error(err_file_open(path));
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+      bool read = read_unmappable(fd, this->m_data, this->m_size);
+      ::close(fd);
+      if (!read) throw std::runtime_error(err_file_read(path));
+      return;
+    }
+
+    this->m_size = static_cast<std::size_t>(st.st_size);
+    if (this->m_size == 0) { // can't map zero bytes
+      ::close(fd);
+      return;
+    }
+
+    void* addr = ::mmap(nullptr, this->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file open by itself
+    if (addr == MAP_FAILED) throw std::runtime_error(err_file_map(path));
+
+    #ifdef MADV_SEQUENTIAL
+    ::madvise(addr, this->m_size, MADV_SEQUENTIAL); // parsing reads front to back
+    #endif
+    this->m_data = static_cast<const char*>(addr);
+    this->mapped = true;
+  }
+  #elif defined(JSXXN_MMAP_WIN32)
+  /**
+   * Reads file to its end into a new[]'d buffer, for handles which aren't
+   * disk files (pipes and character devices) and so can't be mapped.
+   * Returns false on a read error.
+  */
+  bool read_unmappable(HANDLE file, const char*& data, std::size_t& size) {
+    std::size_t capacity = 1 << 16;
+    char* buffer = new char[capacity];
+    size = 0;
+
+    while (true) {
+      if (size == capacity) {
+        char* grown = new char[capacity * 2];
+        std::memcpy(grown, buffer, size);
+        delete[] buffer;
+        buffer = grown;
+        capacity *= 2;
+      }
+
+      DWORD want = static_cast<DWORD>(std::min<std::size_t>(capacity - size, MAXDWORD));
+      DWORD got = 0;
+      if (!ReadFile(file, buffer + size, want, &got, nullptr)) {
+        if (GetLastError() == ERROR_BROKEN_PIPE) break; // the writer closed the pipe
+        delete[] buffer;
+        return false;
+      }
+      if (got == 0) break;
+      size += got;
+    }
+
+    data = buffer;
+    return true;
+  }
+
+  MappedFile::MappedFile(const std::string& path) : m_data(nullptr), m_size(0), mapped(false) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error(err_file_open(path));
+
+    if (GetFileType(file) != FILE_TYPE_DISK) {
+      bool read = read_unmappable(file, this->m_data, this->m_size);
+      CloseHandle(file);
+      if (!read) throw std::runtime_error(err_file_read(path));
+      return;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+      CloseHandle(file);
+      throw std::runtime_error(err_file_open(path));
+    }
+
+    this->m_size = static_cast<std::size_t>(size.QuadPart);
+    if (this->m_size == 0) {
+      CloseHandle(file);
+      return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) throw std::runtime_error(err_file_map(path));
+
+    // the view keeps the mapping alive by itself
+    void* addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (addr == nullptr) throw std::runtime_error(err_file_map(path));
+
+    this->m_data = static_cast<const char*>(addr);
+    this->mapped = true;
+  }
+  #else
+  MappedFile::MappedFile(const std::string& path) : m_data(nullptr), m_size(0), mapped(false) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) throw std::runtime_error(err_file_open(path));
+
+    this->m_size = static_cast<std::size_t>(file.tellg());
+    char* buffer = new char[this->m_size];
+    file.seekg(0);
+    if (!file.read(buffer, static_cast<std::streamsize>(this->m_size))) {
+      delete[] buffer;
+      throw std::runtime_error(err_file_open(path));
+    }
+    this->m_data = buffer;
+  }
+  #endif
+
+  MappedFile::MappedFile(MappedFile&& other) noexcept :
+    m_data(std::exchange(other.m_data, nullptr)),
+    m_size(std::exchange(other.m_size, 0)),
+    mapped(std::exchange(other.mapped, false)) {}
+
+  MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      this->release();
+      this->m_data = std::exchange(other.m_data, nullptr);
+      this->m_size = std::exchange(other.m_size, 0);
+      this->mapped = std::exchange(other.mapped, false);
+    }
+    return *this;
+  }
+
+  MappedFile::~MappedFile() {
+    this->release();
+  }
+
+  void MappedFile::release() {
+    if (this->m_data == nullptr) return;
+
+    if (!this->mapped) delete[] this->m_data;
+    #if defined(JSXXN_MMAP_POSIX)
+    else ::munmap(const_cast<char*>(this->m_data), this->m_size);
+    #elif defined(JSXXN_MMAP_WIN32)
+    else UnmapViewOfFile(this->m_data);
+    #endif
+
+    this->m_data = nullptr;
+    this->m_size = 0;
+  }
+
+  std::string_view MappedFile::view() const {
+    return std::string_view(this->m_data, this->m_size);
+  }
+
+  JSON parse_file(const std::string& path) {
+    MappedFile file(path);
+    return parse(file.view());
+  }
+
+  JSON parse_file(const std::string& path, std::pmr::memory_resource* resource) {
+    MappedFile file(path);
+    return parse(file.view(), resource);
+  }
+
+  void parse_file(const std::string& path, JSONHandler& handler) {
+    MappedFile file(path);
+    parse(file.view(), handler);
+  }
+
+};
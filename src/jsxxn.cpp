@@ -22,10 +22,11 @@ namespace jsxxn {
 
   JSON::JSON(double value) { this->value = value; }
 
-  JSON::JSON(const char* value) { this->value = std::string(value); }
-  JSON::JSON(std::string_view value) { this->value = std::string(value); }
-  JSON::JSON(const std::string& value) { this->value = value; }
-  JSON::JSON(std::string&& value) { this->value = std::move(value); }
+  JSON::JSON(const char* value) { this->value = JSONString(value); }
+  JSON::JSON(std::string_view value) { this->value = JSONString(value); }
+  JSON::JSON(const std::string& value) { this->value = JSONString(value); }
+  JSON::JSON(const JSONString& value) { this->value = value; }
+  JSON::JSON(JSONString&& value) { this->value = std::move(value); }
 
   JSON::JSON(JSONNumber value) { this->value = value; }
   
@@ -42,7 +43,7 @@ namespace jsxxn {
   JSON::JSON(JSONValue&& value) { this->value = std::move(value); }
 
   JSON::JSON(const JSON& other) { this->value = other.value; }
-  JSON::JSON(JSON&& other) { this->value = std::move(other.value); }
+  JSON::JSON(JSON&& other) noexcept : value(std::move(other.value)) {}
 
   JSON::JSON(JSONValueType type) {
     switch (type) {
@@ -50,7 +51,7 @@ namespace jsxxn {
       case JSONValueType::OBJECT: this->value = JSONObject(); break;
       case JSONValueType::BOOLEAN: this->value = false; break;
       case JSONValueType::NUMBER: this->value = 0.0; break;
-      case JSONValueType::STRING: this->value = std::string(); break;
+      case JSONValueType::STRING: this->value = JSONString(); break;
       case JSONValueType::NULLPTR: this->value = nullptr; break;
     }
   }
@@ -62,7 +63,7 @@ namespace jsxxn {
       case JSXXNValueType::BOOLEAN: this->value = false; break;
       case JSXXNValueType::SINTEGER: this->value = 0; break;
       case JSXXNValueType::DOUBLE: this->value = 0.0; break;
-      case JSXXNValueType::STRING: this->value = std::string(); break;
+      case JSXXNValueType::STRING: this->value = JSONString(); break;
       case JSXXNValueType::NULLPTR: this->value = nullptr; break;
     }
   }
@@ -77,14 +78,6 @@ namespace jsxxn {
     return *this;
   }
 
-  JSONValueType JSON::type() const {
-    return json_value_get_type(this->value);
-  }
-
-  JSXXNValueType JSON::xtype() const {
-    return json_value_get_xtype(this->value);
-  }
-
   bool JSON::equals_deep(const JSON& other) const {
     return json_value_equals_deep(this->value, other.value);
   }
@@ -149,19 +142,19 @@ namespace jsxxn {
     " non-literal type to JSONLiteral");
   }
 
-  JSON::operator std::string&() {
+  JSON::operator JSONString&() {
     if (JSONLiteral* literal = std::get_if<JSONLiteral>(&this->value))
-      if (std::string* str = std::get_if<std::string>(literal))
+      if (JSONString* str = std::get_if<JSONString>(literal))
         return *str;
-    throw std::runtime_error("[JSON::operator std::string()] cannot cast "
+    throw std::runtime_error("[JSON::operator JSONString&()] cannot cast "
     " non-string type to string");
   }
 
-  JSON::operator const std::string&() const {
+  JSON::operator const JSONString&() const {
     if (const JSONLiteral* literal = std::get_if<JSONLiteral>(&this->value))
-      if (const std::string* str = std::get_if<std::string>(literal))
+      if (const JSONString* str = std::get_if<JSONString>(literal))
         return *str;
-    throw std::runtime_error("[JSON::operator std::string()] cannot cast "
+    throw std::runtime_error("[JSON::operator JSONString&()] cannot cast "
     " non-string type to string");
   }
 
@@ -237,9 +230,12 @@ namespace jsxxn {
   //                    Object Functions
   // -----------------------------------------------------------
 
-  JSON& JSON::operator[](const std::string& key) {
-    if (JSONObject* map = std::get_if<JSONObject>(&this->value))
-      return (*map)[key];
+  JSON& JSON::operator[](std::string_view key) {
+    if (JSONObject* map = std::get_if<JSONObject>(&this->value)) {
+      auto iter = map->find(key);
+      if (iter != map->end()) return iter->second;
+      return map->emplace(JSONString(key), JSON()).first->second;
+    }
     throw std::runtime_error("[JSON::operator[]] searching key on non-object "
     "type");
   }
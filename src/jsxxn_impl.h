@@ -6,9 +6,15 @@
 
 #include <string_view>
 #include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 
 namespace jsxxn {
-  enum class TokenType {
+  enum class TokenType : std::uint8_t {
     LEFT_BRACE,
     RIGHT_BRACE,
     LEFT_BRACKET,
@@ -23,7 +29,8 @@ namespace jsxxn {
     NUMBER,
     STRING,
 
-    END_OF_FILE
+    END_OF_FILE,
+    ERROR // stands in for a malformed token, see lex_token
   };
   
   typedef std::variant<std::nullptr_t, std::string_view, JSONNumber, bool> TokenLiteral;
@@ -35,29 +42,225 @@ namespace jsxxn {
     const std::string_view str;
     std::size_t curr;
     const std::size_t size;
-    LexState(std::string_view str) : str(str), curr(0), size(str.length()) {}
-    LexState(const LexState& ls) : str(ls.str), curr(0), size(ls.size) {}
+    // set by lex_token on a malformed token, and by the parser on a token
+    // in the wrong place. The positions are the ones the message quotes.
+    ParseErrorCode error;
+    std::size_t error_start;
+    std::size_t error_end;
+    LexState(std::string_view str) :
+      str(str), curr(0), size(str.length()), error(ParseErrorCode::NONE), error_start(0), error_end(0) {}
+    LexState(const LexState& ls) :
+      str(ls.str), curr(0), size(ls.size), error(ParseErrorCode::NONE), error_start(0), error_end(0) {}
   };
 
   struct Token {
     TokenType type;
     TokenLiteral val;
-    Token() : type(TokenType::END_OF_FILE), val("EOF") {}
-    Token(TokenType type, TokenLiteral val) : type(type), val(val) {}
-    Token(const Token& token) : type(token.type), val(token.val) {}
-    Token(Token&& token) : type(token.type), val(token.val) {}
-    void operator=(const Token& tok) { this->type = tok.type; this->val = tok.val; }
-    void operator=(Token&& tok) { this->type = tok.type; this->val = tok.val; }
+    // STRING tokens only: true if the string contains any escape sequences,
+    // and therefore has to go through json_string_resolve
+    bool escaped;
+    Token() : type(TokenType::END_OF_FILE), val("EOF"), escaped(false) {}
+    Token(TokenType type, TokenLiteral val) : type(type), val(val), escaped(false) {}
+    Token(TokenType type, TokenLiteral val, bool escaped) : type(type), val(val), escaped(escaped) {}
   };
 
-  std::vector<Token> tokenize(std::string_view str);
+  /**
+   * Every token of an input, stored as a struct of arrays: a type byte and
+   * a starting offset into the input for every token, and the values of
+   * strings and numbers in columns of their own, in the order their tokens
+   * appear. Punctuation, keywords, and END_OF_FILE (always the last token)
+   * carry nothing beyond their type.
+   *
+   * The string views point into the tokenized input, which must outlive the
+   * tape.
+  */
+  struct TokenTape {
+    std::vector<TokenType> types;
+    std::vector<std::size_t> offsets;
+    std::vector<std::string_view> strings; // contents between the quotes, escapes unresolved
+    std::vector<bool> escaped; // for each of strings, see Token::escaped
+    std::vector<JSONNumber> numbers;
+
+    std::size_t size() const { return this->types.size(); }
+  };
+
+  TokenTape tokenize(std::string_view str);
   Token nextToken(LexState& state);
 
   /**
-   * assumes a valid json string
+   * Moves ls past any whitespace and comments, returning the position of
+   * the next token. Throws on a slash which doesn't start a comment
+  */
+  std::size_t skip_space(LexState& ls);
+
+  /**
+   * nextToken without throwing: a malformed token is recorded in ls and an
+   * ERROR token is returned in its place
   */
-  std::string json_string_resolve(std::string_view v);
+  Token lex_token(LexState& ls);
+
+  /**
+   * Records an error in ls, returning the ERROR token which stands in for
+   * the token it was found at
+  */
+  inline Token lex_fail(LexState& ls, ParseErrorCode code, std::size_t start, std::size_t end) {
+    ls.error = code;
+    ls.error_start = start;
+    ls.error_end = end;
+    return Token(TokenType::ERROR, nullptr);
+  }
+
+  /**
+   * Records a grammar error at the token lexed starting from before, which
+   * is where the lexer was before the whitespace and comments leading up to
+   * the token
+  */
+  inline Token token_fail(LexState& ls, ParseErrorCode code, std::size_t before) {
+    LexState skip(ls.str);
+    skip.curr = before;
+    const std::size_t start = skip_space(skip);
+    return lex_fail(ls, code, start, start);
+  }
+
+  /**
+   * The message of an error recorded in ls, exactly as the throwing front
+   * ends report it. Defined in tokenize.cpp
+  */
+  std::string parse_error_message(ParseErrorCode code, std::string_view str, std::size_t start, std::size_t end);
+
+  inline std::string parse_error_message(const LexState& ls) {
+    return parse_error_message(ls.error, ls.str, ls.error_start, ls.error_end);
+  }
+
+  /**
+   * The ParseError for the error recorded in ls, shared by every front end
+   * reporting through ParseError. Defined in parse.cpp
+  */
+  ParseError parse_error(const LexState& ls);
+
+  struct ShapeKey {
+    std::string_view text; // only unescaped keys are tracked, so this is also the raw text
+    std::uint32_t next; // key which followed this one in its object last time
+    std::uint32_t child; // first key of the object which was this key's value last time
+    std::uint32_t members; // size of the object which was this key's value last time
+  };
+
+  /**
+   * The state behind JSONShapeCache, see parse.cpp. A cache with text
+   * copies each new key into it, so that it can outlive the inputs, and one
+   * without views keys in an input which must outlive the cache.
+  */
+  struct ShapeCacheState {
+    std::vector<ShapeKey> keys;
+    std::vector<std::uint32_t> table; // open addressing, id + 1 or 0 for an empty slot
+    std::uint32_t root_members = 0; // size of the last object which wasn't the value of a key
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> text; // null to view keys in the input
+
+    std::uint32_t find(std::string_view key);
+    std::uint32_t predict(std::string_view key, std::uint32_t prev, bool child);
+  };
+
+  ShapeCacheState& shape_cache_state(JSONShapeCache& cache);
+
+  /**
+   * parse(str, resource, shapes) for a cache which isn't wrapped in a
+   * JSONShapeCache, such as one viewing keys in an input which outlives it
+  */
+  JSON parse(std::string_view str, std::pmr::memory_resource* resource, ShapeCacheState& shapes);
+
+  /**
+   * Skips the comment starting at ls.curr. Throws on a slash which doesn't
+   * start a comment
+  */
+  void consume_comments(LexState& ls);
+
+  /**
+   * Returns the first index at or after i which is not JSON whitespace, or
+   * v.size() if there is none. Vectorized where possible, see scan.cpp
+  */
+  std::size_t scan_whitespace(std::string_view v, std::size_t i);
+
+  /**
+   * Returns the first index at or after i holding a quotation mark, a
+   * backslash, or a control character (< 0x20), or v.size() if there is
+   * none. Vectorized where possible, see scan.cpp
+  */
+  std::size_t scan_string_body(std::string_view v, std::size_t i);
+
+  /**
+   * Returns the first index at or after i holding a byte which has to be
+   * escaped when serializing (quotation mark, backslash, control character,
+   * or DEL), or v.size() if there is none. Vectorized where possible, see
+   * scan.cpp
+  */
+  std::size_t scan_string_escape(std::string_view v, std::size_t i);
+
+  /**
+   * Returns the first index at or after i holding a bracket, a brace, a
+   * quotation mark, or a slash, or v.size() if there is none. Vectorized
+   * where possible, see scan.cpp
+  */
+  std::size_t scan_structural(std::string_view v, std::size_t i);
+
+  /**
+   * assumes a valid json string. The resolved string is allocated out of
+   * resource.
+  */
+  JSONString json_string_resolve(std::string_view v,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+  /**
+   * assumes a valid json string. Appends the resolved string onto out, which
+   * lets callers reuse one buffer across many strings.
+  */
+  void json_string_resolve(std::string_view v, JSONString& out);
+
+  /**
+   * Every serializer is written against these few output operations so
+   * that the same code can append to a std::string or stream out through a
+   * JSONWriter. serialize.cpp adds outputs of its own for measuring and for
+   * presized buffers.
+  */
+  inline void out_put(std::string& output, char ch) { output.push_back(ch); }
+  inline void out_put(JSONWriter& output, char ch) { output.put(ch); }
+  inline void out_write(std::string& output, const char* data, std::size_t size) { output.append(data, size); }
+  inline void out_write(JSONWriter& output, const char* data, std::size_t size) { output.write(data, size); }
+  inline void out_write(std::string& output, std::string_view str) { output.append(str.data(), str.size()); }
+  inline void out_write(JSONWriter& output, std::string_view str) { output.write(str.data(), str.size()); }
+  inline void out_fill(std::string& output, std::size_t count, char ch) { output.append(count, ch); }
+  inline void out_fill(JSONWriter& output, std::size_t count, char ch) { output.fill(count, ch); }
+
+  // Bracket matching helpers behind LazyDocument, defined in lazy.cpp.
+  // lazy_skip_value moves past the value at ls.curr (checking scalars, only
+  // matching brackets of containers), and lazy_next reads the separator
+  // after a member or element, returning false on the closing brace or
+  // bracket.
+  void lazy_skip_value(LexState& ls);
+  bool lazy_next(LexState& ls, bool is_object);
+
+  // Parser error messages, shared by every parser front end so that they all
+  // report malformed input the same way. Defined in parse.cpp
+  std::string err_not_single_val(Token nextToken);
+  std::string err_max_nest();
+  std::string err_expect_json_val(Token token);
+  std::string err_expect_colon(Token token);
+  std::string err_expect_str_key(Token token);
+  std::string err_unclsed_arr();
+  std::string err_unclsed_obj();
+  std::string err_unex_sep_token(Token token);
+  std::string err_unex_arr_token(Token token);
+  std::string err_got_eof();
   
+  /**
+   * Calls job(i) for every i in [0, jobs), spread over up to threads threads
+   * (0 picks std::thread::hardware_concurrency), the calling thread
+   * included. Jobs are claimed one at a time off of a shared counter so that
+   * jobs of uneven cost still keep every thread busy. If any job throws, the
+   * remaining jobs are skipped and the first exception is rethrown once all
+   * threads have stopped. Defined in parallel.cpp
+  */
+  void parallel_for(std::size_t jobs, unsigned int threads, const std::function<void(std::size_t)>& job);
+
   const char* json_token_type_cstr(TokenType tokenType);
   std::string json_token_type_str(TokenType tokenType);
   std::string json_token_str(Token token);
@@ -0,0 +1,227 @@
+#include "jsxxn_impl.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace jsxxn {
+
+  /**
+   * Moves ls past the container opening at ls.curr by counting brackets.
+   * The contents aren't validated, only strings (which may hold brackets)
+   * and comments are recognized, so everything else is jumped over with the
+   * vectorized structural scan.
+  */
+  void lazy_skip_container(LexState& ls) {
+    const bool is_object = ls.str[ls.curr] == '{';
+    std::size_t depth = 0;
+
+    while ((ls.curr = scan_structural(ls.str, ls.curr)) < ls.size) {
+      switch (ls.str[ls.curr]) {
+        case '"': {
+          std::size_t j = ls.curr + 1;
+          while (true) {
+            j = scan_string_body(ls.str, j);
+            if (j == ls.size || ls.str[j] == '"') break;
+            j += ls.str[j] == '\\' ? 2 : 1; // control characters are left to parse()
+          }
+          ls.curr = j + 1;
+        } continue;
+        case '/': consume_comments(ls); continue;
+        case '{': case '[': depth++; break;
+        case '}': case ']': {
+          if (--depth == 0) {
+            ls.curr++;
+            return;
+          }
+        } break;
+        default: break;
+      }
+      ls.curr++;
+    }
+
+    throw std::runtime_error(is_object ? err_unclsed_obj() : err_unclsed_arr());
+  }
+
+  /**
+   * Moves ls past the value starting at ls.curr. Scalars go through the
+   * tokenizer, which checks them along the way.
+  */
+  void lazy_skip_value(LexState& ls) {
+    if (ls.curr < ls.size && (ls.str[ls.curr] == '{' || ls.str[ls.curr] == '[')) {
+      lazy_skip_container(ls);
+      return;
+    }
+
+    Token token = nextToken(ls);
+    switch (token.type) {
+      case TokenType::TRUE:
+      case TokenType::FALSE:
+      case TokenType::NULLPTR:
+      case TokenType::NUMBER:
+      case TokenType::STRING: return;
+      case TokenType::END_OF_FILE: throw std::runtime_error(err_got_eof());
+      default: throw std::runtime_error(err_expect_json_val(token));
+    }
+  }
+
+  /**
+   * Returns a LazyValue for the value at start, after checking that a value
+   * does start there. Scalars are tokenized to check them, containers are
+   * only checked once they are walked.
+  */
+  LazyValue lazy_value(std::string_view str, std::size_t start) {
+    if (start == str.size()) throw std::runtime_error(err_got_eof());
+    if (str[start] != '{' && str[start] != '[') {
+      LexState ls(str);
+      ls.curr = start;
+      lazy_skip_value(ls);
+    }
+    return LazyValue(str, start);
+  }
+
+  /**
+   * Reads the separator after a member or element: returns true on a comma,
+   * false on the closing brace or bracket
+  */
+  bool lazy_next(LexState& ls, bool is_object) {
+    Token token = nextToken(ls);
+    switch (token.type) {
+      case TokenType::COMMA: return true;
+      case TokenType::RIGHT_BRACE: if (is_object) return false; break;
+      case TokenType::RIGHT_BRACKET: if (!is_object) return false; break;
+      case TokenType::END_OF_FILE:
+        throw std::runtime_error(is_object ? err_unclsed_obj() : err_unclsed_arr());
+      default: break;
+    }
+    throw std::runtime_error(is_object ? err_unex_sep_token(token) : err_unex_arr_token(token));
+  }
+
+  /**
+   * Walks the members of the object at start until key is found, returning
+   * the position of its value, or npos if the object has no such member.
+   * Like parse, the first of a repeated key is the one found.
+  */
+  std::size_t lazy_find_key(std::string_view str, std::size_t start, std::string_view key) {
+    if (str[start] != '{')
+      throw std::runtime_error("[LazyValue::at] searching key on non-object type");
+
+    LexState ls(str);
+    ls.curr = start + 1;
+    if (skip_space(ls) < ls.size && str[ls.curr] == '}') return std::string_view::npos;
+
+    JSONString resolved;
+    do {
+      Token token = nextToken(ls);
+      if (token.type != TokenType::STRING)
+        throw std::runtime_error(err_expect_str_key(token));
+      std::string_view name = std::get<std::string_view>(token.val);
+      if (token.escaped) {
+        resolved.clear();
+        json_string_resolve(name, resolved);
+        name = resolved;
+      }
+
+      token = nextToken(ls);
+      if (token.type != TokenType::COLON)
+        throw std::runtime_error(err_expect_colon(token));
+
+      const std::size_t value = skip_space(ls);
+      if (name == key) return value;
+      lazy_skip_value(ls);
+    } while (lazy_next(ls, true));
+
+    return std::string_view::npos;
+  }
+
+  LazyValue::LazyValue(std::string_view str, std::size_t start) : str(str), start(start) {}
+
+  JSONValueType LazyValue::type() const {
+    switch (this->str[this->start]) {
+      case '{': return JSONValueType::OBJECT;
+      case '[': return JSONValueType::ARRAY;
+      case '"': return JSONValueType::STRING;
+      case 't': case 'f': return JSONValueType::BOOLEAN;
+      case 'n': return JSONValueType::NULLPTR;
+      default: return JSONValueType::NUMBER;
+    }
+  }
+
+  LazyValue LazyValue::at(std::string_view key) const {
+    const std::size_t value = lazy_find_key(this->str, this->start, key);
+    if (value == std::string_view::npos)
+      throw std::runtime_error("[LazyValue::at] could not find key");
+    return lazy_value(this->str, value);
+  }
+
+  bool LazyValue::contains(std::string_view key) const {
+    return lazy_find_key(this->str, this->start, key) != std::string_view::npos;
+  }
+
+  LazyValue LazyValue::at(std::size_t idx) const {
+    if (this->str[this->start] != '[')
+      throw std::runtime_error("[LazyValue::at] indexing non-array type");
+
+    LexState ls(this->str);
+    ls.curr = this->start + 1;
+    if (skip_space(ls) == ls.size || this->str[ls.curr] != ']') {
+      for (std::size_t i = 0; ; i++) {
+        const std::size_t value = skip_space(ls);
+        if (i == idx) return lazy_value(this->str, value);
+        lazy_skip_value(ls);
+        if (!lazy_next(ls, false)) break;
+      }
+    }
+    throw std::out_of_range("[LazyValue::at] index out of range");
+  }
+
+  std::size_t LazyValue::size() const {
+    const char open = this->str[this->start];
+    if (open != '{' && open != '[')
+      throw std::runtime_error("[LazyValue::size] queried non-container type");
+    const bool is_object = open == '{';
+
+    LexState ls(this->str);
+    ls.curr = this->start + 1;
+    if (skip_space(ls) < ls.size && this->str[ls.curr] == (is_object ? '}' : ']')) return 0;
+
+    std::size_t count = 0;
+    do {
+      count++;
+      skip_space(ls);
+      if (is_object) {
+        Token token = nextToken(ls);
+        if (token.type != TokenType::STRING)
+          throw std::runtime_error(err_expect_str_key(token));
+        token = nextToken(ls);
+        if (token.type != TokenType::COLON)
+          throw std::runtime_error(err_expect_colon(token));
+        skip_space(ls);
+      }
+      lazy_skip_value(ls);
+    } while (lazy_next(ls, is_object));
+    return count;
+  }
+
+  std::string_view LazyValue::raw() const {
+    LexState ls(this->str);
+    ls.curr = this->start;
+    lazy_skip_value(ls);
+    return this->str.substr(this->start, ls.curr - this->start);
+  }
+
+  JSON LazyValue::parse() const {
+    return jsxxn::parse(this->raw());
+  }
+
+  LazyDocument::LazyDocument(std::string_view str) : str(str), start(0) {
+    LexState ls(str);
+    this->start = skip_space(ls);
+    lazy_value(str, this->start); // throws if there's no value at all
+  }
+
+  LazyValue LazyDocument::root() const {
+    return LazyValue(this->str, this->start);
+  }
+
+};
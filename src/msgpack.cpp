@@ -0,0 +1,310 @@
+#include "jsxxn_impl.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+namespace jsxxn {
+
+  /**
+   * MessagePack (https://msgpack.org/) type bytes used by the encoder and
+   * decoder. Integers, strings, arrays, and maps small enough get "fix"
+   * forms which fit their value or size into the type byte itself.
+  */
+  namespace msgpack {
+    constexpr unsigned char FIXMAP = 0x80;
+    constexpr unsigned char FIXARRAY = 0x90;
+    constexpr unsigned char FIXSTR = 0xa0;
+    constexpr unsigned char NIL = 0xc0;
+    constexpr unsigned char BOOL_FALSE = 0xc2;
+    constexpr unsigned char BOOL_TRUE = 0xc3;
+    constexpr unsigned char FLOAT32 = 0xca;
+    constexpr unsigned char FLOAT64 = 0xcb;
+    constexpr unsigned char UINT8 = 0xcc;
+    constexpr unsigned char UINT16 = 0xcd;
+    constexpr unsigned char UINT32 = 0xce;
+    constexpr unsigned char UINT64 = 0xcf;
+    constexpr unsigned char INT8 = 0xd0;
+    constexpr unsigned char INT16 = 0xd1;
+    constexpr unsigned char INT32 = 0xd2;
+    constexpr unsigned char INT64 = 0xd3;
+    constexpr unsigned char STR8 = 0xd9;
+    constexpr unsigned char STR16 = 0xda;
+    constexpr unsigned char STR32 = 0xdb;
+    constexpr unsigned char ARRAY16 = 0xdc;
+    constexpr unsigned char ARRAY32 = 0xdd;
+    constexpr unsigned char MAP16 = 0xde;
+    constexpr unsigned char MAP32 = 0xdf;
+    constexpr unsigned char NEGATIVE_FIXINT = 0xe0;
+  };
+
+  /**
+   * Writes type followed by the low bytes bytes of value, big endian
+  */
+  template<class Output>
+  inline void msgpack_write_head(Output& output, unsigned char type, std::uint64_t value, int bytes) {
+    char buf[9];
+    buf[0] = static_cast<char>(type);
+    for (int i = bytes; i > 0; i--, value >>= 8)
+      buf[i] = static_cast<char>(value & 0xFF);
+    out_write(output, buf, static_cast<std::size_t>(bytes) + 1);
+  }
+
+  template<class Output>
+  void msgpack_write_int(Output& output, std::int64_t num) {
+    if (num >= 0) {
+      const std::uint64_t u = static_cast<std::uint64_t>(num);
+      if (u < 0x80) out_put(output, static_cast<char>(u));
+      else if (u <= 0xFF) msgpack_write_head(output, msgpack::UINT8, u, 1);
+      else if (u <= 0xFFFF) msgpack_write_head(output, msgpack::UINT16, u, 2);
+      else if (u <= 0xFFFFFFFF) msgpack_write_head(output, msgpack::UINT32, u, 4);
+      else msgpack_write_head(output, msgpack::UINT64, u, 8);
+      return;
+    }
+
+    const std::uint64_t u = static_cast<std::uint64_t>(num); // two's complement bits
+    if (num >= -32) out_put(output, static_cast<char>(u & 0xFF));
+    else if (num >= INT8_MIN) msgpack_write_head(output, msgpack::INT8, u, 1);
+    else if (num >= INT16_MIN) msgpack_write_head(output, msgpack::INT16, u, 2);
+    else if (num >= INT32_MIN) msgpack_write_head(output, msgpack::INT32, u, 4);
+    else msgpack_write_head(output, msgpack::INT64, u, 8);
+  }
+
+  /**
+   * Writes the type byte and size of a string, array, or map. fix is the
+   * fix form's type byte, usable below fix_limit, and type8 the type byte of
+   * the 8 bit size form (0 if there is none), which the 16 and 32 bit forms
+   * follow.
+  */
+  template<class Output>
+  void msgpack_write_size(Output& output, std::size_t size, unsigned char fix,
+    std::size_t fix_limit, unsigned char type8, unsigned char type16) {
+    if (size < fix_limit) out_put(output, static_cast<char>(fix | size));
+    else if (type8 != 0 && size <= 0xFF) msgpack_write_head(output, type8, size, 1);
+    else if (size <= 0xFFFF) msgpack_write_head(output, type16, size, 2);
+    else if (size <= 0xFFFFFFFF) msgpack_write_head(output, type16 + 1, size, 4);
+    else throw std::runtime_error("[jsxxn::to_msgpack] string or container too large for MessagePack");
+  }
+
+  template<class Output>
+  void msgpack_write_str(Output& output, std::string_view str) {
+    msgpack_write_size(output, str.size(), msgpack::FIXSTR, 32, msgpack::STR8, msgpack::STR16);
+    out_write(output, str);
+  }
+
+  template<class Output>
+  void to_msgpack(const JSONValue& json, unsigned int depth, Output& output) {
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH) {
+      throw std::runtime_error("[jsxxn::to_msgpack] Exceeded max nesting "
+      "depth of " + std::to_string(JSXXN_IMPL_MAX_NESTING_DEPTH));
+    }
+
+    std::visit(overloaded {
+      [&output](const JSONLiteral& literal) {
+        std::visit(overloaded {
+          [&output](std::nullptr_t) { out_put(output, static_cast<char>(msgpack::NIL)); },
+          [&output](bool boolean) {
+            out_put(output, static_cast<char>(boolean ? msgpack::BOOL_TRUE : msgpack::BOOL_FALSE));
+          },
+          [&output](const JSONString& str) { msgpack_write_str(output, str); },
+          [&output](const JSONNumber& number) {
+            if (number.index() == 0) {
+              msgpack_write_int(output, std::get<std::int64_t>(number));
+              return;
+            }
+            // always a float 64, which keeps every double exact and doubles
+            // apart from integers when decoded again
+            std::uint64_t bits;
+            double num = std::get<double>(number);
+            std::memcpy(&bits, &num, sizeof(bits));
+            msgpack_write_head(output, msgpack::FLOAT64, bits, 8);
+          }
+        }, literal);
+      },
+      [&output, depth](const JSONObject& object) {
+        msgpack_write_size(output, object.size(), msgpack::FIXMAP, 16, 0, msgpack::MAP16);
+        for (const JSONObject::value_type& entry : object) {
+          msgpack_write_str(output, entry.first);
+          to_msgpack(entry.second.value, depth + 1, output);
+        }
+      },
+      [&output, depth](const JSONArray& arr) {
+        msgpack_write_size(output, arr.size(), msgpack::FIXARRAY, 16, 0, msgpack::ARRAY16);
+        for (const JSON& element : arr)
+          to_msgpack(element.value, depth + 1, output);
+      }
+    }, json);
+  }
+
+  std::string to_msgpack(const JSONValue& json) {
+    std::string output;
+    to_msgpack(json, 0, output);
+    return output;
+  }
+
+  void to_msgpack(const JSONValue& json, JSONWriter& writer) {
+    to_msgpack(json, 0, writer);
+  }
+
+  struct MsgPackState {
+    std::string_view data;
+    std::size_t curr;
+    std::pmr::memory_resource* resource;
+
+    MsgPackState(std::string_view data, std::pmr::memory_resource* resource) :
+      data(data), curr(0), resource(resource) {}
+
+    void need(std::size_t bytes) const {
+      if (bytes > this->data.size() - this->curr)
+        throw std::runtime_error("[jsxxn::parse_msgpack] unexpected end of input");
+    }
+
+    /**
+     * Reads a big endian unsigned integer of bytes bytes
+    */
+    std::uint64_t read_uint(int bytes) {
+      this->need(static_cast<std::size_t>(bytes));
+      std::uint64_t value = 0;
+      for (int i = 0; i < bytes; i++)
+        value = (value << 8) | static_cast<unsigned char>(this->data[this->curr++]);
+      return value;
+    }
+
+    /**
+     * Checks the size of a container of size members, each at least
+     * member_bytes long. Checking it against what's left of the input keeps
+     * a corrupt size from reserving gigabytes up front.
+    */
+    std::size_t read_count(std::uint64_t size, std::size_t member_bytes) {
+      if (size > (this->data.size() - this->curr) / member_bytes)
+        throw std::runtime_error("[jsxxn::parse_msgpack] unexpected end of input");
+      return static_cast<std::size_t>(size);
+    }
+
+    std::string_view read_bytes(std::uint64_t size) {
+      std::string_view bytes = this->data.substr(this->curr, this->read_count(size, 1));
+      this->curr += bytes.size();
+      return bytes;
+    }
+  };
+
+  std::string err_msgpack_type(unsigned char type) {
+    const char* digits = "0123456789abcdef";
+    return std::string("[jsxxn::parse_msgpack] unsupported MessagePack type byte 0x") +
+      digits[type >> 4] + digits[type & 0xF];
+  }
+
+  JSON parse_msgpack_value(MsgPackState& ms, unsigned int depth);
+
+  JSON parse_msgpack_str(MsgPackState& ms, std::uint64_t size) {
+    std::string_view str = ms.read_bytes(size);
+    return JSON(JSONString(str.data(), str.size(), ms.resource));
+  }
+
+  JSON parse_msgpack_array(MsgPackState& ms, std::uint64_t size, unsigned int depth) {
+    const std::size_t count = ms.read_count(size, 1);
+    JSON arr(JSONArray(ms.resource));
+    JSONArray& arrval = std::get<JSONArray>(arr.value);
+    arrval.reserve(count);
+    for (std::size_t i = 0; i < count; i++)
+      arrval.push_back(parse_msgpack_value(ms, depth + 1));
+    return arr;
+  }
+
+  JSON parse_msgpack_map(MsgPackState& ms, std::uint64_t size, unsigned int depth) {
+    const std::size_t count = ms.read_count(size, 2);
+    JSON obj(JSONObject(ms.resource));
+    JSONObject& objval = std::get<JSONObject>(obj.value);
+    #ifndef JSXXN_STD_MAP_OBJECT
+    objval.reserve(count);
+    #endif
+
+    for (std::size_t i = 0; i < count; i++) {
+      ms.need(1);
+      const unsigned char type = static_cast<unsigned char>(ms.data[ms.curr++]);
+      std::uint64_t key_size;
+      if ((type & 0xE0) == msgpack::FIXSTR) key_size = type & 0x1F;
+      else if (type == msgpack::STR8) key_size = ms.read_uint(1);
+      else if (type == msgpack::STR16) key_size = ms.read_uint(2);
+      else if (type == msgpack::STR32) key_size = ms.read_uint(4);
+      else throw std::runtime_error("[jsxxn::parse_msgpack] map keys must be strings");
+
+      std::string_view key = ms.read_bytes(key_size);
+      JSON value = parse_msgpack_value(ms, depth + 1);
+      // a repeated key keeps its first value, like parse does
+      objval.emplace(JSONString(key.data(), key.size(), ms.resource), std::move(value));
+    }
+    return obj;
+  }
+
+  JSON parse_msgpack_value(MsgPackState& ms, unsigned int depth) {
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH)
+      throw std::runtime_error(err_max_nest());
+
+    ms.need(1);
+    const unsigned char type = static_cast<unsigned char>(ms.data[ms.curr++]);
+    if (type < 0x80) return JSON(static_cast<std::int64_t>(type));
+    if (type >= msgpack::NEGATIVE_FIXINT) return JSON(static_cast<std::int64_t>(type) - 0x100);
+    if ((type & 0xF0) == msgpack::FIXMAP) return parse_msgpack_map(ms, type & 0x0F, depth);
+    if ((type & 0xF0) == msgpack::FIXARRAY) return parse_msgpack_array(ms, type & 0x0F, depth);
+    if ((type & 0xE0) == msgpack::FIXSTR) return parse_msgpack_str(ms, type & 0x1F);
+
+    switch (type) {
+      case msgpack::NIL: return JSON(nullptr);
+      case msgpack::BOOL_FALSE: return JSON(false);
+      case msgpack::BOOL_TRUE: return JSON(true);
+      case msgpack::FLOAT32: {
+        const std::uint32_t bits = static_cast<std::uint32_t>(ms.read_uint(4));
+        float num;
+        std::memcpy(&num, &bits, sizeof(num));
+        return JSON(static_cast<double>(num));
+      }
+      case msgpack::FLOAT64: {
+        const std::uint64_t bits = ms.read_uint(8);
+        double num;
+        std::memcpy(&num, &bits, sizeof(num));
+        return JSON(num);
+      }
+      case msgpack::UINT8: return JSON(static_cast<std::int64_t>(ms.read_uint(1)));
+      case msgpack::UINT16: return JSON(static_cast<std::int64_t>(ms.read_uint(2)));
+      case msgpack::UINT32: return JSON(static_cast<std::int64_t>(ms.read_uint(4)));
+      case msgpack::UINT64: {
+        // too big for an int64_t, which parse turns into a double as well
+        const std::uint64_t num = ms.read_uint(8);
+        if (num > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+          return JSON(static_cast<double>(num));
+        return JSON(static_cast<std::int64_t>(num));
+      }
+      case msgpack::INT8: return JSON(static_cast<std::int64_t>(static_cast<std::int8_t>(ms.read_uint(1))));
+      case msgpack::INT16: return JSON(static_cast<std::int64_t>(static_cast<std::int16_t>(ms.read_uint(2))));
+      case msgpack::INT32: return JSON(static_cast<std::int64_t>(static_cast<std::int32_t>(ms.read_uint(4))));
+      case msgpack::INT64: return JSON(static_cast<std::int64_t>(ms.read_uint(8)));
+      case msgpack::STR8: return parse_msgpack_str(ms, ms.read_uint(1));
+      case msgpack::STR16: return parse_msgpack_str(ms, ms.read_uint(2));
+      case msgpack::STR32: return parse_msgpack_str(ms, ms.read_uint(4));
+      case msgpack::ARRAY16: return parse_msgpack_array(ms, ms.read_uint(2), depth);
+      case msgpack::ARRAY32: return parse_msgpack_array(ms, ms.read_uint(4), depth);
+      case msgpack::MAP16: return parse_msgpack_map(ms, ms.read_uint(2), depth);
+      case msgpack::MAP32: return parse_msgpack_map(ms, ms.read_uint(4), depth);
+      default: throw std::runtime_error(err_msgpack_type(type)); // bin, ext, and the unused 0xc1
+    }
+  }
+
+  JSON parse_msgpack(std::string_view data) {
+    return parse_msgpack(data, std::pmr::get_default_resource());
+  }
+
+  JSON parse_msgpack(std::string_view data, std::pmr::memory_resource* resource) {
+    MsgPackState ms(data, resource);
+    JSON value = parse_msgpack_value(ms, 0);
+    if (ms.curr != data.size())
+      throw std::runtime_error("[jsxxn::parse_msgpack] did not read all of the input as a single value");
+    return value;
+  }
+
+};
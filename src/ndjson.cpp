@@ -0,0 +1,62 @@
+#include "jsxxn_impl.h"
+
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <cstring>
+#include <cstddef>
+
+namespace jsxxn {
+
+  /**
+   * Records are handed out to the workers in batches of this many, which is
+   * small enough to keep the threads evenly loaded when record sizes vary a
+   * lot and big enough that the workers rarely touch the shared counter.
+  */
+  constexpr std::size_t NDJSON_BATCH_SIZE = 64;
+
+  void ndjson_parse_record(NDJSONRecord& record, std::string_view text, ShapeCacheState& shapes) {
+    try {
+      record.value = parse(text, std::pmr::get_default_resource(), shapes);
+    } catch (const std::exception& e) {
+      record.error = e.what();
+    }
+  }
+
+  std::vector<NDJSONRecord> parse_ndjson(std::string_view str, unsigned int threads) {
+    std::vector<NDJSONRecord> records;
+    std::vector<std::string_view> texts;
+
+    // JSON strings can't contain a raw line feed (it must be escaped as \n),
+    // so every line feed in valid input is a record boundary and the split
+    // doesn't need to track quotes. A line feed inside of a string just
+    // makes both halves report an error.
+    std::size_t line = 1;
+    for (std::size_t start = 0; start < str.size(); line++) {
+      const char* nl = static_cast<const char*>(
+        std::memchr(str.data() + start, '\n', str.size() - start));
+      std::size_t end = nl != nullptr ? static_cast<std::size_t>(nl - str.data()) : str.size();
+      std::string_view text = str.substr(start, end - start);
+      start = end + 1;
+
+      if (scan_whitespace(text, 0) == text.size()) continue; // blank line
+      records.push_back(NDJSONRecord{ line, JSON(), std::string() });
+      texts.push_back(text);
+    }
+
+    const std::size_t batches = (records.size() + NDJSON_BATCH_SIZE - 1) / NDJSON_BATCH_SIZE;
+    parallel_for(batches, threads, [&records, &texts](std::size_t batch) {
+      const std::size_t start = batch * NDJSON_BATCH_SIZE;
+      const std::size_t end = std::min(start + NDJSON_BATCH_SIZE, records.size());
+      // records in a batch usually share their shape, and the cache's keys
+      // can stay views into str for as long as the batch is parsed
+      ShapeCacheState shapes;
+      for (std::size_t i = start; i < end; i++)
+        ndjson_parse_record(records[i], texts[i], shapes);
+    });
+
+    return records;
+  }
+
+};
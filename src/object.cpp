@@ -0,0 +1,252 @@
+#include "jsxxn.h"
+
+#include <stdexcept>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
+
+namespace jsxxn {
+
+  JSONFlatObject::JSONFlatObject() : entries(), index(nullptr), index_slots(0) {}
+
+  JSONFlatObject::JSONFlatObject(const allocator_type& alloc) :
+    entries(alloc), index(nullptr), index_slots(0) {}
+
+  JSONFlatObject::JSONFlatObject(std::initializer_list<value_type> init, const allocator_type& alloc) :
+    entries(alloc), index(nullptr), index_slots(0) {
+    this->entries.reserve(init.size());
+    for (const value_type& entry : init)
+      this->emplace(entry.first, entry.second);
+  }
+
+  // like every std::pmr container, a copy goes to the default resource
+  // rather than sharing the resource of the original
+  JSONFlatObject::JSONFlatObject(const JSONFlatObject& other) :
+    entries(other.entries), index(nullptr), index_slots(0) {
+    this->index_copy(other);
+  }
+
+  JSONFlatObject::JSONFlatObject(JSONFlatObject&& other) noexcept :
+    entries(std::move(other.entries)),
+    index(std::exchange(other.index, nullptr)),
+    index_slots(std::exchange(other.index_slots, 0)) {}
+
+  JSONFlatObject& JSONFlatObject::operator=(const JSONFlatObject& other) {
+    if (this == &other) return *this;
+    this->entries = other.entries;
+    this->index_copy(other);
+    return *this;
+  }
+
+  JSONFlatObject& JSONFlatObject::operator=(JSONFlatObject&& other) {
+    if (this == &other) return *this;
+    // entries are only stolen when both objects share a resource, and are
+    // otherwise moved over one by one into this object's resource. The index
+    // follows the same rule.
+    const bool same_resource = this->get_allocator() == other.get_allocator();
+    this->entries = std::move(other.entries);
+    if (same_resource) {
+      this->index_free();
+      this->index = std::exchange(other.index, nullptr);
+      this->index_slots = std::exchange(other.index_slots, 0);
+    } else {
+      this->index_copy(other);
+    }
+    other.clear();
+    return *this;
+  }
+
+  JSONFlatObject::~JSONFlatObject() {
+    this->index_free();
+  }
+
+  JSONFlatObject::allocator_type JSONFlatObject::get_allocator() const {
+    return this->entries.get_allocator();
+  }
+
+  JSONFlatObject::iterator JSONFlatObject::begin() { return this->entries.begin(); }
+  JSONFlatObject::const_iterator JSONFlatObject::begin() const { return this->entries.begin(); }
+  JSONFlatObject::iterator JSONFlatObject::end() { return this->entries.end(); }
+  JSONFlatObject::const_iterator JSONFlatObject::end() const { return this->entries.end(); }
+
+  bool JSONFlatObject::empty() const { return this->entries.empty(); }
+  JSONFlatObject::size_type JSONFlatObject::size() const { return this->entries.size(); }
+  JSONFlatObject::size_type JSONFlatObject::max_size() const { return this->entries.max_size(); }
+
+  void JSONFlatObject::clear() {
+    this->entries.clear();
+    this->index_free();
+  }
+
+  void JSONFlatObject::reserve(size_type n) {
+    this->entries.reserve(n);
+
+    // size the index up front too, so it isn't rebuilt on the way to n
+    if (n > INDEX_THRESHOLD) {
+      size_type slots = INDEX_THRESHOLD * 4;
+      while (slots < n * 2) slots *= 2;
+      if (slots > this->index_slots) this->index_rebuild(slots);
+    }
+  }
+
+  JSONFlatObject::iterator JSONFlatObject::find(std::string_view key) {
+    return this->entries.begin() + this->index_find(key);
+  }
+
+  JSONFlatObject::const_iterator JSONFlatObject::find(std::string_view key) const {
+    return this->entries.begin() + this->index_find(key);
+  }
+
+  JSONFlatObject::size_type JSONFlatObject::count(std::string_view key) const {
+    return this->index_find(key) != this->entries.size();
+  }
+
+  bool JSONFlatObject::contains(std::string_view key) const {
+    return this->index_find(key) != this->entries.size();
+  }
+
+  JSON& JSONFlatObject::at(std::string_view key) {
+    size_type pos = this->index_find(key);
+    if (pos == this->entries.size())
+      throw std::out_of_range("[JSONFlatObject::at] could not find key");
+    return this->entries[pos].second;
+  }
+
+  const JSON& JSONFlatObject::at(std::string_view key) const {
+    size_type pos = this->index_find(key);
+    if (pos == this->entries.size())
+      throw std::out_of_range("[JSONFlatObject::at] could not find key");
+    return this->entries[pos].second;
+  }
+
+  JSON& JSONFlatObject::operator[](std::string_view key) {
+    size_type pos = this->index_find(key);
+    if (pos != this->entries.size()) return this->entries[pos].second;
+    return this->emplace(JSONString(key, this->get_allocator()), JSON()).first->second;
+  }
+
+  std::pair<JSONFlatObject::iterator, bool> JSONFlatObject::emplace(JSONString&& key, JSON&& value) {
+    size_type pos = this->index_find(key);
+    if (pos != this->entries.size())
+      return std::make_pair(this->entries.begin() + pos, false);
+
+    this->entries.emplace_back(std::move(key), std::move(value));
+    this->index_insert(pos);
+    return std::make_pair(this->entries.begin() + pos, true);
+  }
+
+  JSONFlatObject::iterator JSONFlatObject::append_unique(JSONString&& key, JSON&& value) {
+    const size_type pos = this->entries.size();
+    this->entries.emplace_back(std::move(key), std::move(value));
+    this->index_insert(pos);
+    return this->entries.begin() + pos;
+  }
+
+  JSONFlatObject::size_type JSONFlatObject::erase(std::string_view key) {
+    size_type pos = this->index_find(key);
+    if (pos == this->entries.size()) return 0;
+    this->entries.erase(this->entries.begin() + pos);
+
+    // every member after pos just shifted down, so the index is rebuilt
+    // from scratch rather than patched
+    if (this->index != nullptr) {
+      if (this->entries.size() > INDEX_THRESHOLD) this->index_rebuild(this->index_slots);
+      else this->index_free();
+    }
+    return 1;
+  }
+
+  /**
+   * Returns the position of key in entries, or entries.size() if key is not
+   * present
+  */
+  JSONFlatObject::size_type JSONFlatObject::index_find(std::string_view key) const {
+    const size_type n = this->entries.size();
+    if (this->index == nullptr) {
+      for (size_type i = 0; i < n; i++)
+        if (this->entries[i].first == key) return i;
+      return n;
+    }
+
+    const size_type mask = this->index_slots - 1;
+    for (size_type slot = std::hash<std::string_view>{}(key) & mask;
+      this->index[slot] != 0; slot = (slot + 1) & mask) {
+      const size_type pos = this->index[slot] - 1;
+      if (this->entries[pos].first == key) return pos;
+    }
+    return n;
+  }
+
+  /**
+   * Registers the member at pos with the index, creating or growing the
+   * index when needed. The table is kept at most half full.
+  */
+  void JSONFlatObject::index_insert(size_type pos) {
+    if (this->index == nullptr) {
+      if (this->entries.size() > INDEX_THRESHOLD)
+        this->index_rebuild(INDEX_THRESHOLD * 4);
+      return;
+    }
+
+    if (this->entries.size() * 2 > this->index_slots) {
+      this->index_rebuild(this->index_slots * 2);
+      return;
+    }
+
+    const size_type mask = this->index_slots - 1;
+    size_type slot = std::hash<std::string_view>{}(this->entries[pos].first) & mask;
+    while (this->index[slot] != 0) slot = (slot + 1) & mask;
+    this->index[slot] = pos + 1;
+  }
+
+  /**
+   * slots must be a power of two
+  */
+  void JSONFlatObject::index_rebuild(size_type slots) {
+    if (slots != this->index_slots) {
+      this->index_free();
+      this->index = std::pmr::polymorphic_allocator<size_type>(
+        this->get_allocator().resource()).allocate(slots);
+      this->index_slots = slots;
+    }
+    std::fill_n(this->index, slots, 0);
+
+    const size_type mask = slots - 1;
+    for (size_type pos = 0; pos < this->entries.size(); pos++) {
+      size_type slot = std::hash<std::string_view>{}(this->entries[pos].first) & mask;
+      while (this->index[slot] != 0) slot = (slot + 1) & mask;
+      this->index[slot] = pos + 1;
+    }
+  }
+
+  /**
+   * Replaces this object's index with a copy of other's, allocated from this
+   * object's resource. entries must already hold a copy of other's entries.
+  */
+  void JSONFlatObject::index_copy(const JSONFlatObject& other) {
+    if (other.index == nullptr) {
+      this->index_free();
+      return;
+    }
+
+    if (this->index_slots != other.index_slots) {
+      this->index_free();
+      this->index = std::pmr::polymorphic_allocator<size_type>(
+        this->get_allocator().resource()).allocate(other.index_slots);
+      this->index_slots = other.index_slots;
+    }
+    std::copy_n(other.index, other.index_slots, this->index);
+  }
+
+  void JSONFlatObject::index_free() {
+    if (this->index == nullptr) return;
+    std::pmr::polymorphic_allocator<size_type>(this->get_allocator().resource())
+      .deallocate(this->index, this->index_slots);
+    this->index = nullptr;
+    this->index_slots = 0;
+  }
+
+};
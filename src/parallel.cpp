@@ -0,0 +1,49 @@
+#include "jsxxn_impl.h"
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+
+namespace jsxxn {
+
+  void parallel_for(std::size_t jobs, unsigned int threads, const std::function<void(std::size_t)>& job) {
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1U);
+    threads = static_cast<unsigned int>(std::min<std::size_t>(threads, jobs));
+
+    if (threads <= 1) {
+      for (std::size_t i = 0; i < jobs; i++) job(i);
+      return;
+    }
+
+    std::atomic<std::size_t> next(0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+      for (std::size_t i = next++; i < jobs; i = next++) {
+        try {
+          job(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) error = std::current_exception();
+          next = jobs; // stop handing out work
+        }
+      }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned int i = 0; i < threads - 1; i++)
+      pool.emplace_back(worker);
+    worker(); // the calling thread works too
+    for (std::thread& thread : pool) thread.join();
+
+    if (error) std::rethrow_exception(error);
+  }
+
+};
@@ -3,76 +3,375 @@
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <vector>
+#include <thread>
+#include <iterator>
+#include <string>
+#include <functional>
+#include <memory>
+#include <cstdint>
 namespace jsxxn {
 
+  constexpr std::uint32_t SHAPE_CACHE_NONE = UINT32_MAX;
+
+  /**
+   * Past this many distinct keys (objects used as maps from ids to values,
+   * for instance) new keys aren't added anymore, and objects holding them
+   * fall back to checking duplicates by string
+  */
+  constexpr std::size_t SHAPE_CACHE_MAX_KEYS = 1 << 14;
+
+  /**
+   * Objects with more members than this check duplicates through their own
+   * hash index instead of by scanning ids
+  */
+  constexpr std::size_t SHAPE_CACHE_MAX_OBJECT_SIZE = 64;
+
+  /**
+   * The parser doesn't throw on malformed input. The first error is
+   * recorded in ls and the current token becomes an ERROR token, which
+   * never matches what any grammar rule expects, so every rule returns as
+   * soon as it sees it and the parse unwinds by ordinary returns.
+  */
   struct ParserState {
     LexState ls;
     Token token;
-    ParserState(std::string_view v) : ls(LexState(v)) {
-      this->token = nextToken(this->ls); // fetches first token!
+    std::size_t before; // where the lexer was before reading token
+    std::pmr::memory_resource* resource; // where every parsed value is allocated
+    ShapeCacheState* shapes; // null unless parsing with a shape cache
+    std::vector<std::uint32_t> key_ids; // ids of the keys of every open object's members
+    std::uint32_t value_key; // id of the key whose value is being parsed
+
+    ParserState(std::string_view v, std::pmr::memory_resource* resource) :
+      ls(LexState(v)), resource(resource), shapes(nullptr), value_key(SHAPE_CACHE_NONE) {
+      this->next(); // fetches first token!
+    }
+
+    ParserState(std::string_view v, std::pmr::memory_resource* resource, ShapeCacheState& shapes) :
+      ls(LexState(v)), resource(resource), shapes(&shapes), value_key(SHAPE_CACHE_NONE) {
+      this->next(); // fetches first token!
     }
 
     void next() {
-      this->token = nextToken(this->ls);
+      this->before = this->ls.curr;
+      this->token = lex_token(this->ls);
+    }
+
+    bool failed() const {
+      return this->token.type == TokenType::ERROR;
+    }
+
+    /**
+     * Records code at the current token, unless the current token is
+     * already an error
+    */
+    void fail(ParseErrorCode code) {
+      if (this->failed()) return;
+      this->token = token_fail(this->ls, code, this->before);
     }
   };
 
-  std::string err_not_single_val(Token nextToken);
-  std::string err_max_nest();
-  std::string err_expect_json_val(Token token);
-  std::string err_expect_colon(Token token);
-  std::string err_expect_str_key(Token token);
-  std::string err_unclsed_arr();
-  std::string err_unclsed_obj();
-  std::string err_unex_sep_token(Token token);
-  std::string err_unex_arr_token(Token token);
-  std::string err_got_eof();
+  /**
+   * Per object bookkeeping of parse_object_pair for the shape cache
+  */
+  struct ObjectShape {
+    std::size_t base; // where this object's ids start in ParserState::key_ids
+    std::uint32_t prev; // id of the previous member's key
+    std::uint32_t parent; // id of the key this object is the value of
+    bool tracked; // cleared once a key isn't in the cache, duplicates are then checked by string
+  };
 
   JSON parse_value(ParserState& ps, unsigned int depth);
   JSON parse_array(ParserState& ps, unsigned int depth);
   JSON parse_object(ParserState& ps, unsigned int depth);
-  void parse_object_pair(ParserState& ps, JSON& obj, unsigned int depth);
+  void parse_object_pair(ParserState& ps, JSONObject& obj, ObjectShape& os, unsigned int depth);
+
+  /**
+   * Parses the whole input of ps, leaving ps failed if it's malformed
+  */
+  JSON parse_root(ParserState& ps) {
+    JSON value = parse_value(ps, 0);
+    if (ps.token.type != TokenType::END_OF_FILE)
+      ps.fail(ParseErrorCode::TRAILING_TOKENS);
+    return value;
+  }
 
   JSON parse(std::string_view str) {
-    ParserState ps(str);
+    return parse(str, std::pmr::get_default_resource());
+  }
 
-    JSON value = parse_value(ps, 0);
-    if (ps.ls.curr < ps.ls.size)
-        throw std::runtime_error(err_not_single_val(nextToken(ps.ls)));
+  JSON parse(std::string_view str, std::pmr::memory_resource* resource) {
+    ParserState ps(str, resource);
+    JSON value = parse_root(ps);
+    if (ps.failed())
+      throw std::runtime_error(parse_error_message(ps.ls));
+    return value;
+  }
+
+  JSON parse(std::string_view str, std::pmr::memory_resource* resource, JSONShapeCache& shapes) {
+    return parse(str, resource, shape_cache_state(shapes));
+  }
 
+  JSON parse(std::string_view str, std::pmr::memory_resource* resource, ShapeCacheState& shapes) {
+    ParserState ps(str, resource, shapes);
+    JSON value = parse_root(ps);
+    if (ps.failed())
+      throw std::runtime_error(parse_error_message(ps.ls));
     return value;
   }
 
-  inline JSONLiteral token_lit_to_json_lit(TokenLiteral literal) {
-    // not sure if if-chain is faster than std::visit with non-capturing lambdas
+  JSON parse(std::string_view str, ParseError& error) {
+    return parse(str, std::pmr::get_default_resource(), error);
+  }
 
-    #if 0
-    if (std::holds_alternative<JSONNumber>(literal)) {
-      JSONNumber num = std::get<JSONNumber>(literal);
-      return JSONLiteral(num);
-    } else if (std::holds_alternative<std::string_view>(literal)) {
-      std::string_view v = std::get<std::string_view>(literal);
-      return JSONLiteral(json_string_resolve(v));
-    } else if (std::holds_alternative<bool>(literal)) {
-      bool b = std::get<bool>(literal);
-      return JSONLiteral(b);
+  JSON parse(std::string_view str, std::pmr::memory_resource* resource, ParseError& error) {
+    ParserState ps(str, resource);
+    JSON value = parse_root(ps);
+    if (ps.failed()) {
+      error = parse_error(ps.ls);
+      return JSON();
     }
+    error = ParseError();
+    return value;
+  }
+
+  ParseError parse_error(const LexState& ls) {
+    ParseError error;
+    error.code = ls.error;
+    error.offset = ls.error_start;
+    error.input = ls.str;
+    error.start = ls.error_start;
+    error.end = ls.error_end;
+
+    error.line = 1;
+    error.column = 1;
+    for (std::size_t i = 0; i < error.offset; i++) {
+      if (ls.str[i] == '\n') {
+        error.line++;
+        error.column = 1;
+      } else {
+        error.column++;
+      }
+    }
+    return error;
+  }
+
+  std::string ParseError::message() const {
+    return parse_error_message(this->code, this->input, this->start, this->end);
+  }
+
+  JSONShapeCache::JSONShapeCache() : state(std::make_unique<ShapeCacheState>()) {
+    // keys have to outlive the inputs they were first seen in
+    this->state->text = std::make_unique<std::pmr::monotonic_buffer_resource>();
+  }
+  JSONShapeCache::JSONShapeCache(JSONShapeCache&& other) noexcept = default;
+  JSONShapeCache& JSONShapeCache::operator=(JSONShapeCache&& other) noexcept = default;
+  JSONShapeCache::~JSONShapeCache() = default;
+
+  std::size_t JSONShapeCache::size() const {
+    return this->state->keys.size();
+  }
+
+  void JSONShapeCache::clear() {
+    this->state->keys.clear();
+    this->state->table.clear();
+    this->state->root_members = 0;
+    this->state->text->release();
+  }
+
+  ShapeCacheState& shape_cache_state(JSONShapeCache& cache) {
+    return *cache.state;
+  }
+
+  /**
+   * Returns the id of key, adding it to the cache if it's new, or
+   * SHAPE_CACHE_NONE if it's new and the cache is full
+  */
+  std::uint32_t ShapeCacheState::find(std::string_view key) {
+    // keep the table at most half full, until the cache stops growing
+    if (this->keys.size() * 2 >= this->table.size() && this->keys.size() < SHAPE_CACHE_MAX_KEYS) {
+      this->table.assign(std::max<std::size_t>(this->table.size() * 2, 64), 0);
+      const std::size_t mask = this->table.size() - 1;
+      for (std::size_t id = 0; id < this->keys.size(); id++) {
+        std::size_t slot = std::hash<std::string_view>{}(this->keys[id].text) & mask;
+        while (this->table[slot] != 0) slot = (slot + 1) & mask;
+        this->table[slot] = static_cast<std::uint32_t>(id + 1);
+      }
+    }
+
+    const std::size_t mask = this->table.size() - 1;
+    std::size_t slot = std::hash<std::string_view>{}(key) & mask;
+    for (; this->table[slot] != 0; slot = (slot + 1) & mask) {
+      const std::uint32_t id = this->table[slot] - 1;
+      if (this->keys[id].text == key) return id;
+    }
+
+    if (this->keys.size() >= SHAPE_CACHE_MAX_KEYS) return SHAPE_CACHE_NONE;
+    const std::uint32_t id = static_cast<std::uint32_t>(this->keys.size());
+    if (this->text != nullptr) {
+      char* copy = static_cast<char*>(this->text->allocate(key.size(), 1));
+      std::copy(key.begin(), key.end(), copy);
+      key = std::string_view(copy, key.size());
+    }
+    this->keys.push_back(ShapeKey{ key, SHAPE_CACHE_NONE, SHAPE_CACHE_NONE, 0 });
+    this->table[slot] = id + 1;
+    return id;
+  }
 
-    return JSONLiteral(nullptr);
-    #endif
+  /**
+   * Returns the id of key like find, but first tries the key which came
+   * after prev last time (or, with child set, the first key of prev's value
+   * last time), then remembers key as that successor
+  */
+  std::uint32_t ShapeCacheState::predict(std::string_view key, std::uint32_t prev, bool child) {
+    if (prev == SHAPE_CACHE_NONE) return this->find(key);
 
+    const std::uint32_t guess = child ? this->keys[prev].child : this->keys[prev].next;
+    if (guess != SHAPE_CACHE_NONE && this->keys[guess].text == key) return guess;
+
+    const std::uint32_t id = this->find(key);
+    (child ? this->keys[prev].child : this->keys[prev].next) = id;
+    return id;
+  }
+
+  /**
+   * Inputs smaller than this aren't worth starting threads for
+  */
+  constexpr std::size_t PARSE_PARALLEL_MIN_SIZE = 1 << 20;
+
+  /**
+   * Elements are grouped into roughly this many chunks per thread, so that a
+   * few slow chunks don't leave the other threads idle at the end
+  */
+  constexpr std::size_t PARSE_PARALLEL_CHUNKS_PER_THREAD = 8;
+
+  /**
+   * Finds the element boundaries of a top level array without parsing it:
+   * fills commas with the position of every comma directly inside of the
+   * array and returns the position of its closing bracket.
+   *
+   * This only tracks strings and bracket depth, it doesn't validate
+   * anything. Returns npos for anything it doesn't want to deal with (not an
+   * array, comments, mismatched or missing brackets, anything after the
+   * array), in which case the caller falls back to parsing sequentially.
+  */
+  std::size_t parse_parallel_prescan(std::string_view str, std::vector<std::size_t>& commas) {
+    constexpr std::size_t npos = std::string_view::npos;
+    std::size_t i = scan_whitespace(str, 0);
+    if (i == str.size() || str[i] != '[') return npos;
+
+    unsigned int depth = 0;
+    for (; i < str.size(); i++) {
+      switch (str[i]) {
+        case '"': {
+          std::size_t j = i + 1;
+          while (true) {
+            j = scan_string_body(str, j);
+            if (j == str.size()) return npos;
+            if (str[j] == '"') break;
+            j += str[j] == '\\' ? 2 : 1; // control characters are left to the parser
+          }
+          i = j;
+        } break;
+        case '[': case '{': depth++; break;
+        case ']': case '}': {
+          if (--depth != 0) break;
+          if (str[i] != ']' || scan_whitespace(str, i + 1) != str.size()) return npos;
+          return i;
+        }
+        case ',': if (depth == 1) commas.push_back(i); break;
+        case '/': return npos;
+        default: break;
+      }
+    }
+
+    return npos;
+  }
+
+  /**
+   * Parses a comma separated run of array elements (without brackets) onto
+   * the end of arr. Returns false if the chunk is malformed.
+  */
+  bool parse_parallel_chunk(std::string_view chunk, JSONArray& arr) {
+    ParserState ps(chunk, std::pmr::get_default_resource());
+    while (true) {
+      arr.push_back(parse_value(ps, 1));
+      if (ps.token.type == TokenType::END_OF_FILE) return true;
+      if (ps.token.type != TokenType::COMMA) return false;
+      ps.next(); // consume comma
+    }
+  }
+
+  JSON parse_parallel(std::string_view str, unsigned int threads) {
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1U);
+    if (threads == 1 || str.size() < PARSE_PARALLEL_MIN_SIZE) return parse(str);
+
+    std::vector<std::size_t> commas;
+    const std::size_t close = parse_parallel_prescan(str, commas);
+    if (close == std::string_view::npos || commas.empty()) return parse(str);
+    const std::size_t open = scan_whitespace(str, 0);
+
+    // group whole elements into chunks of about the same number of bytes
+    const std::size_t target = std::max<std::size_t>(
+      (close - open) / (threads * PARSE_PARALLEL_CHUNKS_PER_THREAD), 1);
+    std::vector<std::string_view> chunks;
+    std::size_t chunk_start = open + 1;
+    for (std::size_t comma : commas) {
+      if (comma - chunk_start < target) continue;
+      chunks.push_back(str.substr(chunk_start, comma - chunk_start));
+      chunk_start = comma + 1;
+    }
+    chunks.push_back(str.substr(chunk_start, close - chunk_start));
+
+    std::vector<JSONArray> parts(chunks.size());
+    std::vector<char> parsed(chunks.size());
+    parallel_for(chunks.size(), threads, [&chunks, &parts, &parsed](std::size_t c) {
+      parsed[c] = parse_parallel_chunk(chunks[c], parts[c]);
+    });
+
+    // if the input is malformed somewhere, parse it again from the start so
+    // that the error is exactly the one parse would report
+    if (std::find(parsed.begin(), parsed.end(), 0) != parsed.end()) return parse(str);
+
+    std::size_t total = 0;
+    for (const JSONArray& part : parts) total += part.size();
+    JSONArray arr;
+    arr.reserve(total);
+    for (JSONArray& part : parts)
+      std::move(part.begin(), part.end(), std::back_inserter(arr));
+    return JSON(std::move(arr));
+  }
+
+  /**
+   * Strings without any escape sequences are already exactly what their
+   * resolved value would be, so they are copied straight out of the source
+   * text in a single assign instead of going through json_string_resolve.
+  */
+  inline JSONString token_str_to_json_str(const Token& token, std::pmr::memory_resource* resource) {
+    std::string_view raw = std::get<std::string_view>(token.val);
+    if (token.escaped) return json_string_resolve(raw, resource);
+    return JSONString(raw, resource);
+  }
+
+  inline JSONLiteral token_to_json_lit(const Token& token, std::pmr::memory_resource* resource) {
+    // not sure if if-chain is faster than std::visit with non-capturing lambdas
     return std::visit(overloaded {
       [](const JSONNumber number) { return JSONLiteral(number); },
       [](const std::nullptr_t nptr) { return JSONLiteral(nptr); },
       [](const bool boolean) { return JSONLiteral(boolean); },
-      [](const std::string_view str) { return JSONLiteral(json_string_resolve(str)); }
-    }, literal);
+      [&token, resource](const std::string_view str) {
+        (void)str;
+        return JSONLiteral(token_str_to_json_str(token, resource));
+      }
+    }, token.val);
   }
 
   JSON parse_value(ParserState& ps, unsigned int depth) {
-    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH)
-      throw std::runtime_error(err_max_nest());
-    
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH) {
+      ps.fail(ParseErrorCode::MAX_NESTING_DEPTH);
+      return JSON();
+    }
+
     switch (ps.token.type) {
       case TokenType::LEFT_BRACE: return parse_object(ps, depth);
       case TokenType::LEFT_BRACKET: return parse_array(ps, depth);
@@ -81,24 +380,25 @@ namespace jsxxn {
       case TokenType::NULLPTR: ps.next(); return JSON(nullptr);
       case TokenType::NUMBER: 
       case TokenType::STRING: {
-        TokenLiteral literal = ps.token.val;
+        JSON literal(token_to_json_lit(ps.token, ps.resource));
         ps.next();
-        return JSON(token_lit_to_json_lit(literal));
+        return literal;
       }
-      case TokenType::END_OF_FILE: throw std::runtime_error(err_got_eof());
+      case TokenType::END_OF_FILE: ps.fail(ParseErrorCode::UNEXPECTED_EOF); return JSON();
       case TokenType::RIGHT_BRACE: 
       case TokenType::RIGHT_BRACKET:
       case TokenType::COLON:
       case TokenType::COMMA: // error
       default:
-        throw std::runtime_error(err_expect_json_val(ps.token));
+        ps.fail(ParseErrorCode::EXPECTED_VALUE);
+        return JSON();
     }
   }
 
   JSON parse_array(ParserState& ps, unsigned int depth) {
     // Array Grammar: "[" (value (, value)* )? "]"
 
-    JSON arr(JSONValueType::ARRAY);
+    JSON arr(JSONArray(ps.resource));
 
     ps.next(); // consume left bracket
     if (ps.token.type == TokenType::RIGHT_BRACKET) {
@@ -116,8 +416,11 @@ namespace jsxxn {
           arr.push_back(parse_value(ps, depth + 1));
         } break;
         case TokenType::END_OF_FILE:
-          throw std::runtime_error(err_unclsed_arr());
-        default: throw std::runtime_error(err_unex_arr_token(ps.token));
+          ps.fail(ParseErrorCode::UNCLOSED_ARRAY);
+          return arr;
+        default:
+          ps.fail(ParseErrorCode::UNEXPECTED_ARRAY_TOKEN);
+          return arr;
       }
     }
 
@@ -126,26 +429,73 @@ namespace jsxxn {
   }
 
 
+  #ifdef JSXXN_STD_MAP_OBJECT
+  inline void object_append_unique(JSONObject& obj, JSONString&& key, JSON&& value) {
+    obj.emplace(std::move(key), std::move(value));
+  }
+
+  inline void object_reserve(JSONObject& obj, std::size_t n) {
+    (void)obj; (void)n; // nodes are allocated one at a time regardless
+  }
+  #else
+  inline void object_append_unique(JSONObject& obj, JSONString&& key, JSON&& value) {
+    obj.append_unique(std::move(key), std::move(value));
+  }
+
+  inline void object_reserve(JSONObject& obj, std::size_t n) {
+    obj.reserve(n);
+  }
+  #endif
+
   // Grammar: STRING ":" value
-  void parse_object_pair(ParserState& ps, JSON& obj, unsigned int depth) {
-    if (ps.token.type != TokenType::STRING)
-      throw std::runtime_error(err_expect_str_key(ps.token));
+  void parse_object_pair(ParserState& ps, JSONObject& obj, ObjectShape& os, unsigned int depth) {
+    if (ps.token.type != TokenType::STRING) {
+      ps.fail(ParseErrorCode::EXPECTED_KEY);
+      return;
+    }
 
-    std::string_view raw_key = std::get<std::string_view>(ps.token.val);
-    std::string key = json_string_resolve(raw_key);
-    ps.next();
+    // escaped keys aren't tracked, since "\u0061" and "a" are the same key
+    // but not the same text
+    std::uint32_t id = SHAPE_CACHE_NONE;
+    if (os.tracked && !ps.token.escaped && obj.size() < SHAPE_CACHE_MAX_OBJECT_SIZE) {
+      id = os.prev == SHAPE_CACHE_NONE
+        ? ps.shapes->predict(std::get<std::string_view>(ps.token.val), os.parent, true)
+        : ps.shapes->predict(std::get<std::string_view>(ps.token.val), os.prev, false);
+    }
 
-    if (ps.token.type != TokenType::COLON)
-      throw std::runtime_error(err_expect_colon(ps.token));
+    JSONString key = token_str_to_json_str(ps.token, ps.resource);
+    ps.next();
 
+    if (ps.token.type != TokenType::COLON) {
+      ps.fail(ParseErrorCode::EXPECTED_COLON);
+      return;
+    }
     ps.next(); // consume colon
-    JSONObject& objval = std::get<JSONObject>(obj.value);
-    objval.emplace(std::move(key), parse_value(ps, depth + 1));
+
+    if (id == SHAPE_CACHE_NONE) {
+      os.tracked = false;
+      ps.value_key = SHAPE_CACHE_NONE;
+      obj.emplace(std::move(key), parse_value(ps, depth + 1));
+      return;
+    }
+
+    // every key so far has an id, so comparing ids replaces emplace's check
+    const auto ids_begin = ps.key_ids.begin() + static_cast<std::ptrdiff_t>(os.base);
+    const bool unique = std::find(ids_begin, ps.key_ids.end(), id) == ps.key_ids.end();
+    ps.key_ids.push_back(id);
+    os.prev = id;
+
+    ps.value_key = id;
+    JSON value = parse_value(ps, depth + 1);
+    if (unique) object_append_unique(obj, std::move(key), std::move(value));
+    // else a duplicate key, where the first member wins like with emplace
   }
 
   JSON parse_object(ParserState& ps, unsigned int depth) {
     // Object Grammar: "{" ( ( STRING ":" value ) (, STRING ":"" value)* )? "}"
-    JSON obj(JSONValueType::OBJECT);
+    JSON obj(JSONObject(ps.resource));
+    JSONObject& objval = std::get<JSONObject>(obj.value);
+    ObjectShape os{ ps.key_ids.size(), SHAPE_CACHE_NONE, ps.value_key, ps.shapes != nullptr };
 
     ps.next(); // consume left curly brace
     if (ps.token.type == TokenType::RIGHT_BRACE) {
@@ -153,20 +503,39 @@ namespace jsxxn {
       return obj;
     }
 
-    parse_object_pair(ps, obj, depth);
+    // records of the same schema are usually the same size, so one
+    // allocation sized like the last object in the same place saves growing
+    // the member list (and the index) a step at a time
+    if (os.tracked) {
+      const std::uint32_t members = os.parent != SHAPE_CACHE_NONE
+        ? ps.shapes->keys[os.parent].members : ps.shapes->root_members;
+      if (members > 1) object_reserve(objval, members);
+    }
+
+    parse_object_pair(ps, objval, os, depth);
 
     while (ps.token.type != TokenType::RIGHT_BRACE) {
       switch (ps.token.type) {
         case TokenType::COMMA: {
           ps.next(); // consume comma
-          parse_object_pair(ps, obj, depth);
+          parse_object_pair(ps, objval, os, depth);
         } break;
         case TokenType::END_OF_FILE:
-          throw std::runtime_error(err_unclsed_obj());
-        default: throw std::runtime_error(err_unex_sep_token(ps.token));
+          ps.fail(ParseErrorCode::UNCLOSED_OBJECT);
+          return obj;
+        default:
+          ps.fail(ParseErrorCode::UNEXPECTED_OBJECT_TOKEN);
+          return obj;
       }
     }
 
+    if (ps.shapes != nullptr) {
+      ps.key_ids.resize(os.base);
+      ps.value_key = os.parent; // for the next element, if this object is in an array
+      // taken again, since parsing the members may have added keys to the cache
+      (os.parent != SHAPE_CACHE_NONE ? ps.shapes->keys[os.parent].members : ps.shapes->root_members) =
+        static_cast<std::uint32_t>(std::min<std::size_t>(objval.size(), UINT32_MAX));
+    }
     ps.next(); // consume right brace
     return obj;
   }
@@ -0,0 +1,195 @@
+#include "jsxxn_impl.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <cstddef>
+#include <utility>
+
+namespace jsxxn {
+
+  /**
+   * Every pointer is evaluated in the same walk over the text. Each step
+   * down into a container carries the pointers whose reference tokens have
+   * matched so far, a member or element is only walked into if some pointer
+   * continues through it, and everything else is skipped by bracket
+   * matching. The walk stops as soon as every pointer has been resolved.
+  */
+  struct ExtractState {
+    std::string_view str;
+    std::vector<std::vector<std::string>> tokens; // reference tokens of every pointer
+    std::vector<std::optional<JSON>>& results;
+    std::size_t remaining; // pointers not resolved yet
+
+    ExtractState(std::string_view str, std::vector<std::optional<JSON>>& results) :
+      str(str), results(results), remaining(0) {}
+  };
+
+  std::string err_bad_pointer(std::string_view pointer) {
+    return "[jsxxn::extract] invalid JSON Pointer \"" + std::string(pointer) + "\"";
+  }
+
+  /**
+   * Splits pointer into its reference tokens, undoing the ~0 and ~1 escapes
+  */
+  std::vector<std::string> pointer_tokens(std::string_view pointer) {
+    std::vector<std::string> tokens;
+    if (pointer.empty()) return tokens; // the whole document
+    if (pointer[0] != '/') throw std::runtime_error(err_bad_pointer(pointer));
+
+    for (std::size_t i = 1; ; i++) {
+      std::string& token = tokens.emplace_back();
+      for (; i < pointer.size() && pointer[i] != '/'; i++) {
+        if (pointer[i] != '~') {
+          token.push_back(pointer[i]);
+          continue;
+        }
+        if (i + 1 == pointer.size() || (pointer[i + 1] != '0' && pointer[i + 1] != '1'))
+          throw std::runtime_error(err_bad_pointer(pointer));
+        token.push_back(pointer[++i] == '0' ? '~' : '/');
+      }
+      if (i >= pointer.size()) return tokens;
+    }
+  }
+
+  /**
+   * The array index a reference token names, or npos if it isn't one:
+   * digits without leading zeros ("-", the element after the last, never
+   * exists when reading)
+  */
+  std::size_t pointer_index(const std::string& token) {
+    constexpr std::size_t npos = std::string::npos;
+    if (token.empty() || token.size() > 18 || (token[0] == '0' && token.size() > 1)) return npos;
+    std::size_t index = 0;
+    for (char ch : token) {
+      if (ch < '0' || ch > '9') return npos;
+      index = index * 10 + static_cast<std::size_t>(ch - '0');
+    }
+    return index;
+  }
+
+  /**
+   * Walks the value at ls.curr on behalf of pointers, all of which have
+   * matched their first depth tokens. Leaves ls after the value, unless
+   * every pointer has been resolved, in which case the walk is abandoned.
+  */
+  void extract_value(ExtractState& es, LexState& ls, const std::vector<std::size_t>& pointers, std::size_t depth) {
+    const std::size_t start = skip_space(ls);
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH)
+      throw std::runtime_error(err_max_nest());
+
+    // pointers ending here take this whole value. If others continue into
+    // it, it's walked a second time for them.
+    std::vector<std::size_t> deeper;
+    bool ends_here = false;
+    for (std::size_t p : pointers) {
+      if (es.tokens[p].size() == depth) ends_here = true;
+      else deeper.push_back(p);
+    }
+
+    if (ends_here) {
+      lazy_skip_value(ls);
+      JSON value = parse(es.str.substr(start, ls.curr - start));
+      for (std::size_t p : pointers) {
+        if (es.tokens[p].size() != depth) continue;
+        es.results[p] = value;
+        es.remaining--;
+      }
+      if (deeper.empty() || es.remaining == 0) return;
+
+      const std::size_t end = ls.curr;
+      ls.curr = start;
+      extract_value(es, ls, deeper, depth);
+      ls.curr = end;
+      return;
+    }
+
+    const char open = start < ls.size ? es.str[start] : '\0';
+    if (open != '{' && open != '[') { // no pointer can go further
+      lazy_skip_value(ls);
+      return;
+    }
+
+    const bool is_object = open == '{';
+    ls.curr++; // consume left brace or bracket
+    if (skip_space(ls) < ls.size && es.str[ls.curr] == (is_object ? '}' : ']')) {
+      ls.curr++;
+      return;
+    }
+
+    // pointers which have already found their member here, since only the
+    // first of a repeated key counts
+    std::vector<std::size_t> taken;
+    std::vector<std::size_t> matching;
+    JSONString resolved;
+    std::size_t index = 0;
+
+    do {
+      matching.clear();
+      if (is_object) {
+        Token token = nextToken(ls);
+        if (token.type != TokenType::STRING)
+          throw std::runtime_error(err_expect_str_key(token));
+        std::string_view key = std::get<std::string_view>(token.val);
+        if (token.escaped) {
+          resolved.clear();
+          json_string_resolve(key, resolved);
+          key = resolved;
+        }
+
+        token = nextToken(ls);
+        if (token.type != TokenType::COLON)
+          throw std::runtime_error(err_expect_colon(token));
+
+        for (std::size_t p : pointers) {
+          if (es.tokens[p][depth] != key) continue;
+          bool seen = false;
+          for (std::size_t t : taken) seen = seen || t == p;
+          if (!seen) {
+            matching.push_back(p);
+            taken.push_back(p);
+          }
+        }
+      } else {
+        for (std::size_t p : pointers)
+          if (pointer_index(es.tokens[p][depth]) == index) matching.push_back(p);
+        index++;
+      }
+
+      if (matching.empty()) {
+        skip_space(ls);
+        lazy_skip_value(ls);
+      } else {
+        extract_value(es, ls, matching, depth + 1);
+        if (es.remaining == 0) return;
+      }
+    } while (lazy_next(ls, is_object));
+  }
+
+  std::vector<std::optional<JSON>> extract(std::string_view json, const std::vector<std::string_view>& pointers) {
+    std::vector<std::optional<JSON>> results(pointers.size());
+    ExtractState es(json, results);
+
+    std::vector<std::size_t> all;
+    for (std::size_t p = 0; p < pointers.size(); p++) {
+      es.tokens.push_back(pointer_tokens(pointers[p]));
+      all.push_back(p);
+    }
+    es.remaining = pointers.size();
+    if (es.remaining == 0) return results;
+
+    LexState ls(json);
+    extract_value(es, ls, all, 0);
+    return results;
+  }
+
+  JSON extract(std::string_view json, std::string_view pointer) {
+    std::vector<std::optional<JSON>> results = extract(json, std::vector<std::string_view>{ pointer });
+    if (!results[0].has_value())
+      throw std::runtime_error("[jsxxn::extract] could not find \"" + std::string(pointer) + "\"");
+    return std::move(*results[0]);
+  }
+
+};
@@ -0,0 +1,315 @@
+#include "jsxxn_impl.h"
+
+#include "jsxxn_string.h"
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstddef>
+#include <cctype>
+#include <algorithm>
+
+namespace jsxxn {
+
+  /**
+   * The recursive descent parser in parse.cpp keeps its position in the
+   * grammar on the call stack, which can't be suspended in the middle of a
+   * chunk. The push parser instead keeps an explicit stack of open
+   * containers plus the grammar rule it's in the middle of, and advances one
+   * token at a time.
+   *
+   * Tokens themselves still come from nextToken. Before a token is handed to
+   * nextToken, push_token_end makes sure that all of it has arrived, so that
+   * nextToken sees exactly what it would have seen with the whole document
+   * in memory and reports the same errors.
+  */
+  enum class PushExpect {
+    VALUE, // any value
+    ARRAY_FIRST, // a value or "]", right after "["
+    ARRAY_NEXT, // "," or "]"
+    OBJECT_FIRST, // a key or "}", right after "{"
+    OBJECT_KEY,
+    OBJECT_COLON,
+    OBJECT_NEXT, // "," or "}"
+    DONE // the (only) top level value has been read
+  };
+
+  struct PushParserState {
+    JSONHandler& handler;
+    const bool multiple_values;
+    PushExpect expect;
+    std::vector<TokenType> open; // LEFT_BRACE or LEFT_BRACKET of every open container
+    std::string pending; // unfinished token at the end of the previous chunks
+    std::size_t scanned; // how much of pending push_token_end has already checked
+    JSONString scratch; // escaped strings are resolved into here
+    bool finished;
+
+    PushParserState(JSONHandler& handler, bool multiple_values) :
+      handler(handler), multiple_values(multiple_values),
+      expect(PushExpect::VALUE), scanned(0), finished(false) {}
+  };
+
+  std::size_t push_consume(PushParserState& ps, std::string_view v, bool final);
+  std::size_t push_token_end(std::string_view v, std::size_t& i, std::size_t& scanned);
+  void push_token(PushParserState& ps, const Token& token);
+  void push_value(PushParserState& ps, const Token& token);
+  void push_after_value(PushParserState& ps);
+  std::string_view push_token_str(PushParserState& ps, const Token& token);
+
+  PushParser::PushParser(JSONHandler& handler, bool multiple_values) :
+    state(std::make_unique<PushParserState>(handler, multiple_values)) {}
+
+  PushParser::~PushParser() = default;
+
+  void PushParser::feed(std::string_view chunk) {
+    PushParserState& ps = *this->state;
+    if (ps.finished)
+      throw std::runtime_error("[jsxxn::PushParser::feed] fed input after finish");
+
+    // the last chunk ended in the middle of a token: copy only as much of
+    // this chunk as finishes it, growing the copy by at least as much as is
+    // already pending so that a long token is still copied in linear time
+    std::size_t used = 0; // how much of chunk has been appended to pending
+    while (ps.pending.size() > used) { // the unfinished token began before chunk
+      if (used == chunk.size()) return;
+      std::size_t more = std::min(chunk.size() - used, std::max<std::size_t>(ps.pending.size(), 64));
+      ps.pending.append(chunk.data() + used, more);
+      used += more;
+      ps.pending.erase(0, push_consume(ps, ps.pending, false));
+    }
+
+    // whatever is still pending now lies at the end of chunk's first used
+    // bytes, so parse the chunk in place from there and only copy whatever
+    // incomplete token it ends with
+    chunk.remove_prefix(used - ps.pending.size());
+    std::size_t consumed = push_consume(ps, chunk, false);
+    ps.pending.assign(chunk.data() + consumed, chunk.size() - consumed);
+  }
+
+  void PushParser::finish() {
+    PushParserState& ps = *this->state;
+    if (ps.finished) return;
+    ps.finished = true;
+    push_consume(ps, ps.pending, true);
+    ps.pending.clear();
+    push_token(ps, Token(TokenType::END_OF_FILE, nullptr));
+  }
+
+  /**
+   * Feeds every complete token of v through the grammar, returning how many
+   * bytes of v were used. When final is set, v is the rest of the input and
+   * is read completely.
+  */
+  std::size_t push_consume(PushParserState& ps, std::string_view v, bool final) {
+    LexState ls(v);
+
+    while (ls.curr < ls.size) {
+      if (!final) {
+        // on npos, ls.curr is left at the unfinished token, so that only
+        // the token itself is kept for the next chunk
+        std::size_t start = push_token_end(v, ls.curr, ps.scanned);
+        if (start == std::string_view::npos) break; // wait for more input
+        ls.curr = start;
+        if (ls.curr == ls.size) break;
+      }
+
+      Token token = nextToken(ls);
+      if (token.type == TokenType::END_OF_FILE) break; // only trailing whitespace
+      push_token(ps, token);
+    }
+
+    return ls.curr;
+  }
+
+  constexpr inline bool push_is_word_char(char ch) {
+    return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+      (ch >= 'A' && ch <= 'Z') || ch == '+' || ch == '-' || ch == '.';
+  }
+
+  /**
+   * Skips the whitespace and comments at i, then checks that the whole token
+   * after them is inside of v. Returns the start of that token (or v.size()
+   * if v ends in whitespace), or npos if the input cuts off before the token
+   * or comment ends.
+   *
+   * On npos, i is moved to the start of the unfinished token or comment and
+   * scanned is set to how many of its bytes have been checked. The next
+   * call, once more input has been appended after it, picks up from there
+   * instead of scanning the token from its start again, so a long string
+   * arriving in many small chunks is still only scanned once.
+   *
+   * A number or keyword is only known to be complete once the character after
+   * it has arrived, since "12" or "tru" could continue in the next chunk.
+   * Anything which can't start a token at all is let through immediately so
+   * that nextToken can report it.
+  */
+  std::size_t push_token_end(std::string_view v, std::size_t& i, std::size_t& scanned) {
+    constexpr std::size_t npos = std::string_view::npos;
+    // stops scanning at j, which is still inside of the token or comment at i
+    auto unfinished = [&i, &scanned](std::size_t j) {
+      scanned = j - i;
+      return npos;
+    };
+
+    while (true) {
+      i = scan_whitespace(v, i);
+      if (i == v.size()) return i;
+      if (v[i] != '/') break;
+
+      switch (stridx(v, i + 1)) {
+        case '/': {
+          std::size_t end = v.find('\n', std::max(i + 2, i + scanned));
+          if (end == npos) return unfinished(v.size());
+          i = end;
+        } break;
+        case '*': {
+          std::size_t end = v.find("*/", std::max(i + 2, i + scanned));
+          // the last byte may be the '*' of the closing "*/"
+          if (end == npos) return unfinished(std::max(i + 2, v.size() - 1));
+          i = end + 2;
+        } break;
+        case '\0': if (i + 1 == v.size()) return unfinished(i); return i;
+        default: return i; // nextToken will throw on the stray slash
+      }
+      scanned = 0;
+    }
+
+    std::size_t j = i + scanned;
+    scanned = 0;
+    switch (v[i]) {
+      case '{': case '}': case '[': case ']': case ',': case ':': return i;
+      case '"': {
+        j = std::max(j, i + 1);
+        while (true) {
+          j = scan_string_body(v, j);
+          if (j == v.size()) return unfinished(j);
+          if (v[j] != '\\') return i; // closing quote, or a control character error
+          if (j + 2 > v.size()) return unfinished(j);
+          j += 2;
+        }
+      }
+      default: {
+        while (j < v.size() && push_is_word_char(v[j])) j++;
+        return j == v.size() ? unfinished(j) : i;
+      }
+    }
+  }
+
+  void push_token(PushParserState& ps, const Token& token) {
+    switch (ps.expect) {
+      case PushExpect::VALUE: push_value(ps, token); return;
+      case PushExpect::ARRAY_FIRST: {
+        if (token.type != TokenType::RIGHT_BRACKET) {
+          push_value(ps, token);
+          return;
+        }
+        ps.open.pop_back();
+        ps.handler.on_end_array();
+        push_after_value(ps);
+      } return;
+      case PushExpect::ARRAY_NEXT: {
+        switch (token.type) {
+          case TokenType::COMMA: ps.expect = PushExpect::VALUE; return;
+          case TokenType::RIGHT_BRACKET: {
+            ps.open.pop_back();
+            ps.handler.on_end_array();
+            push_after_value(ps);
+          } return;
+          case TokenType::END_OF_FILE:
+            throw std::runtime_error(err_unclsed_arr());
+          default: throw std::runtime_error(err_unex_arr_token(token));
+        }
+      }
+      case PushExpect::OBJECT_FIRST:
+        if (token.type == TokenType::RIGHT_BRACE) {
+          ps.open.pop_back();
+          ps.handler.on_end_object();
+          push_after_value(ps);
+          return;
+        }
+        [[fallthrough]];
+      case PushExpect::OBJECT_KEY: {
+        if (token.type != TokenType::STRING)
+          throw std::runtime_error(err_expect_str_key(token));
+        ps.handler.on_key(push_token_str(ps, token));
+        ps.expect = PushExpect::OBJECT_COLON;
+      } return;
+      case PushExpect::OBJECT_COLON: {
+        if (token.type != TokenType::COLON)
+          throw std::runtime_error(err_expect_colon(token));
+        ps.expect = PushExpect::VALUE;
+      } return;
+      case PushExpect::OBJECT_NEXT: {
+        switch (token.type) {
+          case TokenType::COMMA: ps.expect = PushExpect::OBJECT_KEY; return;
+          case TokenType::RIGHT_BRACE: {
+            ps.open.pop_back();
+            ps.handler.on_end_object();
+            push_after_value(ps);
+          } return;
+          case TokenType::END_OF_FILE:
+            throw std::runtime_error(err_unclsed_obj());
+          default: throw std::runtime_error(err_unex_sep_token(token));
+        }
+      }
+      case PushExpect::DONE: {
+        if (token.type != TokenType::END_OF_FILE)
+          throw std::runtime_error(err_not_single_val(token));
+      } return;
+    }
+  }
+
+  void push_value(PushParserState& ps, const Token& token) {
+    if (ps.open.size() > JSXXN_IMPL_MAX_NESTING_DEPTH)
+      throw std::runtime_error(err_max_nest());
+
+    switch (token.type) {
+      case TokenType::LEFT_BRACE: {
+        ps.open.push_back(TokenType::LEFT_BRACE);
+        ps.handler.on_start_object();
+        ps.expect = PushExpect::OBJECT_FIRST;
+      } return;
+      case TokenType::LEFT_BRACKET: {
+        ps.open.push_back(TokenType::LEFT_BRACKET);
+        ps.handler.on_start_array();
+        ps.expect = PushExpect::ARRAY_FIRST;
+      } return;
+      case TokenType::TRUE: ps.handler.on_bool(true); break;
+      case TokenType::FALSE: ps.handler.on_bool(false); break;
+      case TokenType::NULLPTR: ps.handler.on_null(); break;
+      case TokenType::NUMBER: ps.handler.on_number(std::get<JSONNumber>(token.val)); break;
+      case TokenType::STRING: ps.handler.on_string(push_token_str(ps, token)); break;
+      case TokenType::END_OF_FILE: {
+        // an empty stream is fine, a stream cut off after a comma or colon isn't
+        if (ps.multiple_values && ps.open.empty()) return;
+        throw std::runtime_error(err_got_eof());
+      }
+      case TokenType::RIGHT_BRACE:
+      case TokenType::RIGHT_BRACKET:
+      case TokenType::COLON:
+      case TokenType::COMMA: // error
+      default:
+        throw std::runtime_error(err_expect_json_val(token));
+    }
+
+    push_after_value(ps);
+  }
+
+  void push_after_value(PushParserState& ps) {
+    if (ps.open.empty())
+      ps.expect = ps.multiple_values ? PushExpect::VALUE : PushExpect::DONE;
+    else if (ps.open.back() == TokenType::LEFT_BRACKET)
+      ps.expect = PushExpect::ARRAY_NEXT;
+    else ps.expect = PushExpect::OBJECT_NEXT;
+  }
+
+  std::string_view push_token_str(PushParserState& ps, const Token& token) {
+    std::string_view raw = std::get<std::string_view>(token.val);
+    if (!token.escaped) return raw;
+    ps.scratch.clear();
+    json_string_resolve(raw, ps.scratch);
+    return ps.scratch;
+  }
+
+};
@@ -0,0 +1,233 @@
+#include "jsxxn_impl.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace jsxxn {
+
+  /**
+   * Follows the same grammar as the parser in parse.cpp and throws the same
+   * errors, but leaves it to the caller to say what comes next instead of
+   * recursing on its own.
+   *
+   * Whether a comma is due before the next member or element is kept in a
+   * single flag rather than a stack: it's only ever false right after a
+   * container is opened, and closing a nested container always leaves its
+   * parent with at least one member.
+  */
+  struct JSONReaderState {
+    LexState ls;
+    Token token;
+    // end of the token before the current one, so that read_raw can find
+    // where a value started and ended
+    std::size_t prev_end;
+    unsigned int depth; // number of open containers
+    bool first; // no member or element read yet in the innermost container
+    // escaped strings and keys are resolved into these buffers. Keys get
+    // their own so that a key is still intact while its value is read.
+    JSONString scratch;
+    JSONString key_scratch;
+
+    JSONReaderState(std::string_view v) :
+      ls(LexState(v)), prev_end(0), depth(0), first(false) {
+      this->token = nextToken(this->ls); // fetches first token!
+    }
+
+    void next() {
+      this->prev_end = this->ls.curr;
+      this->token = nextToken(this->ls);
+    }
+
+    std::string_view token_str(JSONString& buffer) {
+      std::string_view raw = std::get<std::string_view>(this->token.val);
+      if (!this->token.escaped) return raw;
+      buffer.clear();
+      json_string_resolve(raw, buffer);
+      return buffer;
+    }
+  };
+
+  std::string err_reader_type(JSONValueType expected, JSONValueType got) {
+    return std::string("[jsxxn::JSONReader] expected a value of type ") +
+      jsonvt_str(expected) + ", got " + jsonvt_str(got);
+  }
+
+  /**
+   * Type of the value the current token starts, throwing the parser's errors
+   * if it doesn't start one
+  */
+  JSONValueType reader_value_type(const JSONReaderState& rs) {
+    if (rs.depth > JSXXN_IMPL_MAX_NESTING_DEPTH)
+      throw std::runtime_error(err_max_nest());
+
+    switch (rs.token.type) {
+      case TokenType::LEFT_BRACE: return JSONValueType::OBJECT;
+      case TokenType::LEFT_BRACKET: return JSONValueType::ARRAY;
+      case TokenType::TRUE:
+      case TokenType::FALSE: return JSONValueType::BOOLEAN;
+      case TokenType::NULLPTR: return JSONValueType::NULLPTR;
+      case TokenType::NUMBER: return JSONValueType::NUMBER;
+      case TokenType::STRING: return JSONValueType::STRING;
+      case TokenType::END_OF_FILE: throw std::runtime_error(err_got_eof());
+      case TokenType::RIGHT_BRACE:
+      case TokenType::RIGHT_BRACKET:
+      case TokenType::COLON:
+      case TokenType::COMMA: // error
+      default:
+        throw std::runtime_error(err_expect_json_val(rs.token));
+    }
+  }
+
+  void reader_expect(const JSONReaderState& rs, JSONValueType expected) {
+    JSONValueType got = reader_value_type(rs);
+    if (got != expected)
+      throw std::runtime_error(err_reader_type(expected, got));
+  }
+
+  JSONReader::JSONReader(std::string_view str) :
+    state(std::make_unique<JSONReaderState>(str)) {}
+
+  JSONReader::~JSONReader() = default;
+
+  JSONValueType JSONReader::peek() const {
+    return reader_value_type(*this->state);
+  }
+
+  void JSONReader::read_null() {
+    reader_expect(*this->state, JSONValueType::NULLPTR);
+    this->state->next();
+  }
+
+  bool JSONReader::read_bool() {
+    JSONReaderState& rs = *this->state;
+    reader_expect(rs, JSONValueType::BOOLEAN);
+    bool value = rs.token.type == TokenType::TRUE;
+    rs.next();
+    return value;
+  }
+
+  JSONNumber JSONReader::read_number() {
+    JSONReaderState& rs = *this->state;
+    reader_expect(rs, JSONValueType::NUMBER);
+    JSONNumber value = std::get<JSONNumber>(rs.token.val);
+    rs.next();
+    return value;
+  }
+
+  JSONNumber JSONReader::read_number(std::string_view& text) {
+    JSONReaderState& rs = *this->state;
+    reader_expect(rs, JSONValueType::NUMBER);
+    LexState skip(rs.ls.str);
+    skip.curr = rs.prev_end;
+    const std::size_t start = skip_space(skip); // past any comments before the number
+    text = rs.ls.str.substr(start, rs.ls.curr - start);
+    return this->read_number();
+  }
+
+  std::string_view JSONReader::read_string() {
+    JSONReaderState& rs = *this->state;
+    reader_expect(rs, JSONValueType::STRING);
+    std::string_view value = rs.token_str(rs.scratch);
+    rs.next();
+    return value;
+  }
+
+  std::string_view JSONReader::read_raw() {
+    JSONReaderState& rs = *this->state;
+    reader_value_type(rs); // throws if there's no value to read
+    LexState skip(rs.ls.str);
+    skip.curr = rs.prev_end;
+    const std::size_t start = skip_space(skip); // past any comments before the value
+    this->skip();
+    return rs.ls.str.substr(start, rs.prev_end - start);
+  }
+
+  void JSONReader::skip() {
+    std::string_view key;
+    switch (reader_value_type(*this->state)) {
+      case JSONValueType::OBJECT: {
+        this->begin_object();
+        while (this->next_key(key)) this->skip();
+      } return;
+      case JSONValueType::ARRAY: {
+        this->begin_array();
+        while (this->next_element()) this->skip();
+      } return;
+      default: this->state->next(); return;
+    }
+  }
+
+  void JSONReader::begin_object() {
+    JSONReaderState& rs = *this->state;
+    reader_expect(rs, JSONValueType::OBJECT);
+    rs.next(); // consume left curly brace
+    rs.depth++;
+    rs.first = true;
+  }
+
+  bool JSONReader::next_key(std::string_view& key) {
+    JSONReaderState& rs = *this->state;
+    if (rs.token.type == TokenType::RIGHT_BRACE) {
+      rs.next(); // consume right curly brace
+      rs.depth--;
+      rs.first = false;
+      return false;
+    }
+
+    if (!rs.first) {
+      switch (rs.token.type) {
+        case TokenType::COMMA: rs.next(); break; // consume comma
+        case TokenType::END_OF_FILE: throw std::runtime_error(err_unclsed_obj());
+        default: throw std::runtime_error(err_unex_sep_token(rs.token));
+      }
+    }
+    rs.first = false;
+
+    // Grammar: STRING ":" value
+    if (rs.token.type != TokenType::STRING)
+      throw std::runtime_error(err_expect_str_key(rs.token));
+    key = rs.token_str(rs.key_scratch);
+    rs.next();
+
+    if (rs.token.type != TokenType::COLON)
+      throw std::runtime_error(err_expect_colon(rs.token));
+    rs.next(); // consume colon
+    return true;
+  }
+
+  void JSONReader::begin_array() {
+    JSONReaderState& rs = *this->state;
+    reader_expect(rs, JSONValueType::ARRAY);
+    rs.next(); // consume left bracket
+    rs.depth++;
+    rs.first = true;
+  }
+
+  bool JSONReader::next_element() {
+    JSONReaderState& rs = *this->state;
+    if (rs.token.type == TokenType::RIGHT_BRACKET) {
+      rs.next(); // consume right bracket
+      rs.depth--;
+      rs.first = false;
+      return false;
+    }
+
+    if (!rs.first) {
+      switch (rs.token.type) {
+        case TokenType::COMMA: rs.next(); break; // consume comma
+        case TokenType::END_OF_FILE: throw std::runtime_error(err_unclsed_arr());
+        default: throw std::runtime_error(err_unex_arr_token(rs.token));
+      }
+    }
+    rs.first = false;
+    return true;
+  }
+
+  void JSONReader::finish() {
+    JSONReaderState& rs = *this->state;
+    if (rs.token.type != TokenType::END_OF_FILE)
+      throw std::runtime_error(err_not_single_val(rs.token));
+  }
+
+};
@@ -0,0 +1,193 @@
+#include "jsxxn_impl.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace jsxxn {
+
+  /**
+   * Event-driven counterpart to the parser in parse.cpp. Follows the same
+   * grammar and throws the same errors, but hands every value straight to a
+   * JSONHandler instead of building JSON values.
+  */
+  struct SAXState {
+    LexState ls;
+    Token token;
+    JSONHandler& handler;
+    // escaped strings are resolved into this buffer, which is reused for
+    // every string so that reading strings does not allocate
+    JSONString scratch;
+    SAXState(std::string_view v, JSONHandler& handler) :
+      ls(LexState(v)), handler(handler) {
+      this->token = nextToken(this->ls); // fetches first token!
+    }
+
+    void next() {
+      this->token = nextToken(this->ls);
+    }
+
+    std::string_view token_str() {
+      std::string_view raw = std::get<std::string_view>(this->token.val);
+      if (!this->token.escaped) return raw;
+      this->scratch.clear();
+      json_string_resolve(raw, this->scratch);
+      return this->scratch;
+    }
+  };
+
+  void sax_value(SAXState& ss, unsigned int depth);
+  void sax_array(SAXState& ss, unsigned int depth);
+  void sax_object(SAXState& ss, unsigned int depth);
+  void sax_object_pair(SAXState& ss, unsigned int depth);
+
+  void parse(std::string_view str, JSONHandler& handler) {
+    SAXState ss(str, handler);
+
+    sax_value(ss, 0);
+    if (ss.token.type != TokenType::END_OF_FILE)
+      throw std::runtime_error(err_not_single_val(ss.token));
+  }
+
+  void sax_value(SAXState& ss, unsigned int depth) {
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH)
+      throw std::runtime_error(err_max_nest());
+
+    switch (ss.token.type) {
+      case TokenType::LEFT_BRACE: sax_object(ss, depth); return;
+      case TokenType::LEFT_BRACKET: sax_array(ss, depth); return;
+      case TokenType::TRUE: ss.handler.on_bool(true); break;
+      case TokenType::FALSE: ss.handler.on_bool(false); break;
+      case TokenType::NULLPTR: ss.handler.on_null(); break;
+      case TokenType::NUMBER: ss.handler.on_number(std::get<JSONNumber>(ss.token.val)); break;
+      case TokenType::STRING: ss.handler.on_string(ss.token_str()); break;
+      case TokenType::END_OF_FILE: throw std::runtime_error(err_got_eof());
+      case TokenType::RIGHT_BRACE:
+      case TokenType::RIGHT_BRACKET:
+      case TokenType::COLON:
+      case TokenType::COMMA: // error
+      default:
+        throw std::runtime_error(err_expect_json_val(ss.token));
+    }
+
+    ss.next();
+  }
+
+  void sax_array(SAXState& ss, unsigned int depth) {
+    // Array Grammar: "[" (value (, value)* )? "]"
+    ss.handler.on_start_array();
+
+    ss.next(); // consume left bracket
+    if (ss.token.type != TokenType::RIGHT_BRACKET) {
+      sax_value(ss, depth + 1);
+
+      while (ss.token.type != TokenType::RIGHT_BRACKET) {
+        switch (ss.token.type) {
+          case TokenType::COMMA: {
+            ss.next(); // consume comma
+            sax_value(ss, depth + 1);
+          } break;
+          case TokenType::END_OF_FILE:
+            throw std::runtime_error(err_unclsed_arr());
+          default: throw std::runtime_error(err_unex_arr_token(ss.token));
+        }
+      }
+    }
+
+    ss.next(); // consume right bracket
+    ss.handler.on_end_array();
+  }
+
+  // Grammar: STRING ":" value
+  void sax_object_pair(SAXState& ss, unsigned int depth) {
+    if (ss.token.type != TokenType::STRING)
+      throw std::runtime_error(err_expect_str_key(ss.token));
+
+    ss.handler.on_key(ss.token_str());
+    ss.next();
+
+    if (ss.token.type != TokenType::COLON)
+      throw std::runtime_error(err_expect_colon(ss.token));
+
+    ss.next(); // consume colon
+    sax_value(ss, depth + 1);
+  }
+
+  void sax_object(SAXState& ss, unsigned int depth) {
+    // Object Grammar: "{" ( ( STRING ":" value ) (, STRING ":"" value)* )? "}"
+    ss.handler.on_start_object();
+
+    ss.next(); // consume left curly brace
+    if (ss.token.type != TokenType::RIGHT_BRACE) {
+      sax_object_pair(ss, depth);
+
+      while (ss.token.type != TokenType::RIGHT_BRACE) {
+        switch (ss.token.type) {
+          case TokenType::COMMA: {
+            ss.next(); // consume comma
+            sax_object_pair(ss, depth);
+          } break;
+          case TokenType::END_OF_FILE:
+            throw std::runtime_error(err_unclsed_obj());
+          default: throw std::runtime_error(err_unex_sep_token(ss.token));
+        }
+      }
+    }
+
+    ss.next(); // consume right brace
+    ss.handler.on_end_object();
+  }
+
+  JSONBuilder::JSONBuilder(ValueCallback on_value, std::pmr::memory_resource* resource) :
+    on_value(std::move(on_value)), resource(resource) {}
+
+  void JSONBuilder::on_null() { this->add(JSON(nullptr)); }
+  void JSONBuilder::on_bool(bool value) { this->add(JSON(value)); }
+  void JSONBuilder::on_number(JSONNumber value) { this->add(JSON(value)); }
+
+  void JSONBuilder::on_string(std::string_view value) {
+    this->add(JSON(JSONString(value, this->resource)));
+  }
+
+  void JSONBuilder::on_key(std::string_view key) {
+    this->keys.back().assign(key.data(), key.size());
+  }
+
+  void JSONBuilder::on_start_object() {
+    this->open.emplace_back(JSONObject(this->resource));
+    this->keys.emplace_back(this->resource);
+  }
+
+  void JSONBuilder::on_end_object() {
+    JSON obj = std::move(this->open.back());
+    this->open.pop_back();
+    this->keys.pop_back();
+    this->add(std::move(obj));
+  }
+
+  void JSONBuilder::on_start_array() {
+    this->open.emplace_back(JSONArray(this->resource));
+  }
+
+  void JSONBuilder::on_end_array() {
+    JSON arr = std::move(this->open.back());
+    this->open.pop_back();
+    this->add(std::move(arr));
+  }
+
+  void JSONBuilder::add(JSON&& value) {
+    if (this->open.empty()) {
+      this->on_value(std::move(value));
+      return;
+    }
+
+    JSONValue& parent = this->open.back().value;
+    if (JSONArray* arr = std::get_if<JSONArray>(&parent)) {
+      arr->push_back(std::move(value));
+      return;
+    }
+
+    std::get<JSONObject>(parent).emplace(std::move(this->keys.back()), std::move(value));
+    this->keys.back() = JSONString(this->resource);
+  }
+
+};
@@ -0,0 +1,332 @@
+#include "jsxxn_impl.h"
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Vectorized scanning loops used by the tokenizer.
+ *
+ * The tokenizer spends most of its time in two loops: skipping runs of
+ * whitespace between tokens (long ones in pretty-printed input) and walking
+ * over the body of strings. The serializer likewise walks over strings
+ * looking for characters which need escaping, and the lazy document
+ * jumps over whole containers looking only for the characters which
+ * change its bracket depth. All of these only need to
+ * find the first byte out of a small set, which can be checked 16 or 32 bytes at a time by
+ * comparing every byte of a vector register at once and turning the results
+ * into a bitmask. The index of the first set bit is then the answer.
+ *
+ * SSE2 is part of the x86-64 baseline, so it is always used there. AVX2 is
+ * chosen at runtime when the CPU supports it (GCC and Clang only, since they
+ * allow compiling single functions for a specific target). Everything else
+ * falls back to plain byte loops. Defining JSXXN_NO_SIMD forces the byte
+ * loops everywhere.
+ *
+ * None of the vector loops ever read past the end of the given view: the
+ * final partial block is always finished with the byte loop.
+ *
+ * The AVX2 loops finish with the SSE2 ones, which are compiled without VEX
+ * encoding. Running those with the upper halves of the ymm registers still
+ * dirty stalls on every AVX/SSE transition (hundreds of cycles per call on
+ * some machines, which is ruinous for short strings), so the AVX2 loops
+ * clear them with vzeroupper first, and hand input shorter than one 32 byte
+ * block straight to SSE2 without touching the ymm registers at all.
+*/
+
+#if !defined(JSXXN_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64)) \
+    && (defined(__GNUC__) || defined(_MSC_VER))
+  #define JSXXN_SCAN_SSE2
+  #include <emmintrin.h>
+  #if defined(__GNUC__)
+    #define JSXXN_SCAN_AVX2
+    #include <immintrin.h>
+  #else
+    #include <intrin.h>
+  #endif
+#endif
+
+namespace jsxxn {
+
+  constexpr inline bool scan_is_ws(unsigned char ch) {
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+  }
+
+  /**
+   * Bytes which end the plain run of a string body: the closing quotation
+   * mark, the start of an escape sequence, and control characters (which
+   * either end the string or are an error)
+  */
+  constexpr inline bool scan_is_str_special(unsigned char ch) {
+    return ch == '"' || ch == '\\' || ch < 0x20;
+  }
+
+  /**
+   * Bytes which the serializer has to escape: the quotation mark, the
+   * backslash, control characters, and DEL
+  */
+  constexpr inline bool scan_is_escaped(unsigned char ch) {
+    return ch == '"' || ch == '\\' || ch < 0x20 || ch == 0x7F;
+  }
+
+  /**
+   * Bytes which matter when skipping over a container without parsing it:
+   * brackets, braces, the quotation mark which starts a string (which could
+   * hold brackets), and the slash which starts a comment
+  */
+  constexpr inline bool scan_is_structural(unsigned char ch) {
+    return ch == '"' || ch == '/' || (ch | 0x20) == '{' || (ch | 0x20) == '}';
+  }
+
+  std::size_t scan_whitespace_scalar(std::string_view v, std::size_t i) {
+    while (i < v.size() && scan_is_ws(v[i])) i++;
+    return i;
+  }
+
+  std::size_t scan_string_body_scalar(std::string_view v, std::size_t i) {
+    while (i < v.size() && !scan_is_str_special(v[i])) i++;
+    return i;
+  }
+
+  std::size_t scan_string_escape_scalar(std::string_view v, std::size_t i) {
+    while (i < v.size() && !scan_is_escaped(v[i])) i++;
+    return i;
+  }
+
+  std::size_t scan_structural_scalar(std::string_view v, std::size_t i) {
+    while (i < v.size() && !scan_is_structural(v[i])) i++;
+    return i;
+  }
+
+  #if defined(__GNUC__)
+  inline unsigned int scan_ctz(std::uint32_t mask) { return __builtin_ctz(mask); }
+  #elif defined(_MSC_VER)
+  inline unsigned int scan_ctz(std::uint32_t mask) {
+    unsigned long ind;
+    _BitScanForward(&ind, mask);
+    return ind;
+  }
+  #endif
+
+  #ifdef JSXXN_SCAN_SSE2
+  std::size_t scan_whitespace_sse2(std::string_view v, std::size_t i) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+
+    for (; i + 16 <= v.size(); i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v.data() + i));
+      __m128i ws = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, nl)),
+        _mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, tab)));
+      std::uint32_t not_ws = ~static_cast<std::uint32_t>(_mm_movemask_epi8(ws)) & 0xFFFF;
+      if (not_ws != 0) return i + scan_ctz(not_ws);
+    }
+
+    return scan_whitespace_scalar(v, i);
+  }
+
+  std::size_t scan_string_body_sse2(std::string_view v, std::size_t i) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bkslsh = _mm_set1_epi8('\\');
+    const __m128i ctrl_max = _mm_set1_epi8(0x1F);
+
+    for (; i + 16 <= v.size(); i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v.data() + i));
+      // there is no unsigned byte comparison in SSE2, but
+      // max(block, 0x1F) == 0x1F exactly when block <= 0x1F
+      __m128i ctrl = _mm_cmpeq_epi8(_mm_max_epu8(block, ctrl_max), ctrl_max);
+      __m128i special = _mm_or_si128(ctrl,
+        _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, bkslsh)));
+      std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(special));
+      if (mask != 0) return i + scan_ctz(mask);
+    }
+
+    return scan_string_body_scalar(v, i);
+  }
+
+  std::size_t scan_string_escape_sse2(std::string_view v, std::size_t i) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bkslsh = _mm_set1_epi8('\\');
+    const __m128i del = _mm_set1_epi8(0x7F);
+    const __m128i ctrl_max = _mm_set1_epi8(0x1F);
+
+    for (; i + 16 <= v.size(); i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v.data() + i));
+      __m128i ctrl = _mm_cmpeq_epi8(_mm_max_epu8(block, ctrl_max), ctrl_max);
+      __m128i special = _mm_or_si128(
+        _mm_or_si128(ctrl, _mm_cmpeq_epi8(block, del)),
+        _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, bkslsh)));
+      std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(special));
+      if (mask != 0) return i + scan_ctz(mask);
+    }
+
+    return scan_string_escape_scalar(v, i);
+  }
+
+  std::size_t scan_structural_sse2(std::string_view v, std::size_t i) {
+    // '[' and ']' are '{' and '}' with bit 0x20 cleared
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i lbrace = _mm_set1_epi8('{');
+    const __m128i rbrace = _mm_set1_epi8('}');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('/');
+
+    for (; i + 16 <= v.size(); i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v.data() + i));
+      __m128i folded = _mm_or_si128(block, case_bit);
+      __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(folded, lbrace), _mm_cmpeq_epi8(folded, rbrace)),
+        _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, slash)));
+      std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(special));
+      if (mask != 0) return i + scan_ctz(mask);
+    }
+
+    return scan_structural_scalar(v, i);
+  }
+  #endif
+
+  #ifdef JSXXN_SCAN_AVX2
+  __attribute__((target("avx2")))
+  std::size_t scan_whitespace_avx2(std::string_view v, std::size_t i) {
+    if (i + 32 > v.size()) return scan_whitespace_sse2(v, i);
+
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i tab = _mm256_set1_epi8('\t');
+
+    for (; i + 32 <= v.size(); i += 32) {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data() + i));
+      __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, nl)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, cr), _mm256_cmpeq_epi8(block, tab)));
+      std::uint32_t not_ws = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(ws));
+      if (not_ws != 0) return i + scan_ctz(not_ws);
+    }
+
+    _mm256_zeroupper(); // the SSE2 tail is not VEX encoded
+    return scan_whitespace_sse2(v, i);
+  }
+
+  __attribute__((target("avx2")))
+  std::size_t scan_string_body_avx2(std::string_view v, std::size_t i) {
+    if (i + 32 > v.size()) return scan_string_body_sse2(v, i);
+
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i bkslsh = _mm256_set1_epi8('\\');
+    const __m256i ctrl_max = _mm256_set1_epi8(0x1F);
+
+    for (; i + 32 <= v.size(); i += 32) {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data() + i));
+      __m256i ctrl = _mm256_cmpeq_epi8(_mm256_max_epu8(block, ctrl_max), ctrl_max);
+      __m256i special = _mm256_or_si256(ctrl,
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, bkslsh)));
+      std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(special));
+      if (mask != 0) return i + scan_ctz(mask);
+    }
+
+    _mm256_zeroupper(); // the SSE2 tail is not VEX encoded
+    return scan_string_body_sse2(v, i);
+  }
+
+  __attribute__((target("avx2")))
+  std::size_t scan_string_escape_avx2(std::string_view v, std::size_t i) {
+    if (i + 32 > v.size()) return scan_string_escape_sse2(v, i);
+
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i bkslsh = _mm256_set1_epi8('\\');
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    const __m256i ctrl_max = _mm256_set1_epi8(0x1F);
+
+    for (; i + 32 <= v.size(); i += 32) {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data() + i));
+      __m256i ctrl = _mm256_cmpeq_epi8(_mm256_max_epu8(block, ctrl_max), ctrl_max);
+      __m256i special = _mm256_or_si256(
+        _mm256_or_si256(ctrl, _mm256_cmpeq_epi8(block, del)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, bkslsh)));
+      std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(special));
+      if (mask != 0) return i + scan_ctz(mask);
+    }
+
+    _mm256_zeroupper(); // the SSE2 tail is not VEX encoded
+    return scan_string_escape_sse2(v, i);
+  }
+
+  __attribute__((target("avx2")))
+  std::size_t scan_structural_avx2(std::string_view v, std::size_t i) {
+    if (i + 32 > v.size()) return scan_structural_sse2(v, i);
+
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i lbrace = _mm256_set1_epi8('{');
+    const __m256i rbrace = _mm256_set1_epi8('}');
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i slash = _mm256_set1_epi8('/');
+
+    for (; i + 32 <= v.size(); i += 32) {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data() + i));
+      __m256i folded = _mm256_or_si256(block, case_bit);
+      __m256i special = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, lbrace), _mm256_cmpeq_epi8(folded, rbrace)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, slash)));
+      std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(special));
+      if (mask != 0) return i + scan_ctz(mask);
+    }
+
+    _mm256_zeroupper(); // the SSE2 tail is not VEX encoded
+    return scan_structural_sse2(v, i);
+  }
+  #endif
+
+  typedef std::size_t ScanFunc(std::string_view v, std::size_t i);
+
+  struct ScanFuncs {
+    ScanFunc* whitespace;
+    ScanFunc* string_body;
+    ScanFunc* string_escape;
+    ScanFunc* structural;
+  };
+
+  ScanFuncs select_scan_funcs() {
+    #ifdef JSXXN_SCAN_AVX2
+    __builtin_cpu_init(); // in case we are called from a static initializer
+    if (__builtin_cpu_supports("avx2"))
+      return ScanFuncs{ scan_whitespace_avx2, scan_string_body_avx2, scan_string_escape_avx2,
+        scan_structural_avx2 };
+    #endif
+    #ifdef JSXXN_SCAN_SSE2
+    return ScanFuncs{ scan_whitespace_sse2, scan_string_body_sse2, scan_string_escape_sse2,
+      scan_structural_sse2 };
+    #else
+    return ScanFuncs{ scan_whitespace_scalar, scan_string_body_scalar, scan_string_escape_scalar,
+      scan_structural_scalar };
+    #endif
+  }
+
+  // resolved once, on first use
+  const ScanFuncs& scan_funcs() {
+    static const ScanFuncs funcs = select_scan_funcs();
+    return funcs;
+  }
+
+  std::size_t scan_whitespace(std::string_view v, std::size_t i) {
+    // short runs (a single space between tokens) are the common case in
+    // minified input, so don't pay for a vector load on them
+    if (i < v.size() && !scan_is_ws(v[i])) return i;
+    return scan_funcs().whitespace(v, i);
+  }
+
+  std::size_t scan_string_body(std::string_view v, std::size_t i) {
+    return scan_funcs().string_body(v, i);
+  }
+
+  std::size_t scan_string_escape(std::string_view v, std::size_t i) {
+    return scan_funcs().string_escape(v, i);
+  }
+
+  std::size_t scan_structural(std::string_view v, std::size_t i) {
+    return scan_funcs().structural(v, i);
+  }
+
+};
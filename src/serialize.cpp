@@ -4,20 +4,64 @@
 
 #include <stdexcept>
 #include <sstream>
+#include <charconv>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <iterator>
+#include <thread>
+#include <string_view>
 
 
 namespace jsxxn {
-  void prettify(const JSONValue& json, unsigned int depth, std::string& output);
-  void stringify(const JSONValue& json, unsigned int depth, std::string& output);
-  void json_literal_serialize(const JSONLiteral& literal, std::string& output);
-  void json_number_serialize(const JSONNumber& number, std::string& output);
-  void json_string_serialize(std::string_view str, std::string& output);
-
-  inline void u16_as_hexstr(std::uint16_t val, std::string& output) {
-    output.push_back(xdigit_as_ch((val & 0xF000) >> 12));
-    output.push_back(xdigit_as_ch((val & 0x0F00) >> 8));
-    output.push_back(xdigit_as_ch((val & 0x00F0) >> 4));
-    output.push_back(xdigit_as_ch(val & 0x000F));
+
+  /**
+   * Output which only counts how many bytes would have been written, used to
+   * find the exact serialized size of a tree before writing it
+  */
+  struct SizeCounter {
+    std::size_t size = 0;
+  };
+
+  inline void out_put(SizeCounter& output, char ch) { (void)ch; output.size++; }
+  inline void out_write(SizeCounter& output, const char* data, std::size_t size) { (void)data; output.size += size; }
+  inline void out_write(SizeCounter& output, std::string_view str) { output.size += str.size(); }
+  inline void out_fill(SizeCounter& output, std::size_t count, char ch) { (void)ch; output.size += count; }
+
+  /**
+   * Output into memory already known to be big enough, so nothing is ever
+   * checked or reallocated
+  */
+  struct RawBuffer {
+    char* curr;
+  };
+
+  inline void out_put(RawBuffer& output, char ch) { *output.curr++ = ch; }
+  inline void out_write(RawBuffer& output, const char* data, std::size_t size) {
+    std::memcpy(output.curr, data, size);
+    output.curr += size;
+  }
+  inline void out_write(RawBuffer& output, std::string_view str) { out_write(output, str.data(), str.size()); }
+  inline void out_fill(RawBuffer& output, std::size_t count, char ch) {
+    std::memset(output.curr, ch, count);
+    output.curr += count;
+  }
+
+  template<class Output> void prettify(const JSONValue& json, unsigned int depth, Output& output);
+  template<class Output> void stringify(const JSONValue& json, unsigned int depth, Output& output);
+  template<class Output> void json_literal_serialize(const JSONLiteral& literal, Output& output);
+  template<class Output> void json_number_serialize(const JSONNumber& number, Output& output);
+  template<class Output> void json_string_serialize(std::string_view str, Output& output);
+
+  template<class Output>
+  inline void u16_as_hexstr(std::uint16_t val, Output& output) {
+    out_put(output, xdigit_as_ch((val & 0xF000) >> 12));
+    out_put(output, xdigit_as_ch((val & 0x0F00) >> 8));
+    out_put(output, xdigit_as_ch((val & 0x00F0) >> 4));
+    out_put(output, xdigit_as_ch(val & 0x000F));
   }
   
   std::string prettify(const JSONValue& json) {
@@ -32,21 +76,92 @@ namespace jsxxn {
     return output;
   }
 
+  void prettify(const JSONValue& json, JSONWriter& writer) {
+    prettify(json, 0, writer);
+  }
+
+  void stringify(const JSONValue& json, JSONWriter& writer) {
+    stringify(json, 0, writer);
+  }
+
+  std::size_t prettify_size(const JSONValue& json) {
+    SizeCounter counter;
+    prettify(json, 0, counter);
+    return counter.size;
+  }
+
+  std::size_t stringify_size(const JSONValue& json) {
+    SizeCounter counter;
+    stringify(json, 0, counter);
+    return counter.size;
+  }
+
+  char* prettify(const JSONValue& json, char* output) {
+    RawBuffer buffer{ output };
+    prettify(json, 0, buffer);
+    return buffer.curr;
+  }
+
+  char* stringify(const JSONValue& json, char* output) {
+    RawBuffer buffer{ output };
+    stringify(json, 0, buffer);
+    return buffer.curr;
+  }
+
   std::string json_number_serialize(const JSONNumber& number) {
-    return std::visit(overloaded {
-      [](const std::int64_t num) { return std::to_string(num); },
-      [](const double num) { return std::to_string(num); }
-    }, number);
+    std::string output;
+    json_number_serialize(number, output);
+    return output;
   }
 
-  void json_number_serialize(const JSONNumber& number, std::string& output) {
-    // we end up having to allocate a string anyway while serializing the
-    // numbers... so we can just have the result of the non-capturing 
-    // std::visit append directly onto the output string
+  template<class Output>
+  void json_int_serialize(std::int64_t num, Output& output) {
+    char buf[24]; // 19 digits and a sign at most
+    std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), num);
+    out_write(output, buf, static_cast<std::size_t>(res.ptr - buf));
+  }
+
+  /**
+   * Writes the shortest decimal representation of num which still parses
+   * back to exactly the same double.
+   *
+   * Doubles are always written with a decimal point (1.0, 1.0e+30) so that
+   * they are read back as doubles rather than as integers. NaN and infinity
+   * have no JSON representation and are written as null, like JavaScript's
+   * JSON.stringify does.
+  */
+  template<class Output>
+  void json_double_serialize(double num, Output& output) {
+    if (!std::isfinite(num)) {
+      out_write(output, "null");
+      return;
+    }
+
+    char buf[40];
+    #if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    char* end = std::to_chars(buf, buf + sizeof(buf), num).ptr;
+    #else
+    // not necessarily the shortest, but 17 significant digits always round
+    // trip a double
+    char* end = buf + std::snprintf(buf, sizeof(buf), "%.17g", num);
+    #endif
 
-    output += std::visit(overloaded {
-      [](const std::int64_t num) { return std::to_string(num); },
-      [](const double num) { return std::to_string(num); }
+    char* exp = std::find(buf, end, 'e');
+    if (std::find(buf, exp, '.') != exp) {
+      out_write(output, buf, static_cast<std::size_t>(end - buf));
+      return;
+    }
+
+    out_write(output, buf, static_cast<std::size_t>(exp - buf));
+    out_write(output, ".0");
+    out_write(output, exp, static_cast<std::size_t>(end - exp));
+  }
+
+  template<class Output>
+  void json_number_serialize(const JSONNumber& number, Output& output) {
+    std::visit(overloaded {
+      [&output](const std::int64_t num) { json_int_serialize(num, output); },
+      [&output](const double num) { json_double_serialize(num, output); }
     }, number);
   }
 
@@ -56,31 +171,35 @@ namespace jsxxn {
     return output;
   }
 
-  void json_string_serialize(std::string_view str, std::string& output) {
-    output.push_back('\"');
-
-    for (std::string_view::size_type i = 0; i < str.size(); i++) {
-      switch (str[i]) {
-        case '"': output.append("\\\""); break;
-        case '\\': output.append("\\\\"); break;
-        case '\b': output.append("\\b"); break;
-        case '\f': output.append("\\f"); break;
-        case '\n': output.append("\\n"); break;
-        case '\r': output.append("\\r"); break;
-        case '\t': output.append("\\t"); break;
-        default: {
-          // control characters get turned into unicode escapes
-          if (std::iscntrl(str[i]) || str[i] == 127) {
-            output += "\\u";
-            u16_as_hexstr(static_cast<std::uint16_t>(str[i]), output);
-          } else { // all other unicode characters can just be unescaped
-            output.push_back(str[i]);
-          }
+  template<class Output>
+  void json_string_serialize(std::string_view str, Output& output) {
+    out_put(output, '\"');
+
+    // most strings have nothing to escape at all, so copy everything up to
+    // the next character which needs escaping in one go
+    std::string_view::size_type i = 0;
+    while (true) {
+      std::string_view::size_type next = scan_string_escape(str, i);
+      out_write(output, str.data() + i, next - i);
+      if (next == str.size()) break;
+
+      switch (str[next]) {
+        case '"': out_write(output, "\\\""); break;
+        case '\\': out_write(output, "\\\\"); break;
+        case '\b': out_write(output, "\\b"); break;
+        case '\f': out_write(output, "\\f"); break;
+        case '\n': out_write(output, "\\n"); break;
+        case '\r': out_write(output, "\\r"); break;
+        case '\t': out_write(output, "\\t"); break;
+        default: { // any other control character (or DEL) becomes a unicode escape
+          out_write(output, "\\u");
+          u16_as_hexstr(static_cast<std::uint16_t>(str[next]), output);
         }
       }
+      i = next + 1;
     }
 
-    output.push_back('\"');
+    out_put(output, '\"');
   }
 
   std::string json_string_serialize(std::string_view v) {
@@ -89,23 +208,41 @@ namespace jsxxn {
     return out;
   }
 
-  void json_literal_serialize(const JSONLiteral& literal, std::string& output) { 
+  void json_string_serialize(std::string_view v, std::string& output) {
+    json_string_serialize<std::string>(v, output);
+  }
+
+  void json_string_serialize(std::string_view v, JSONWriter& output) {
+    json_string_serialize<JSONWriter>(v, output);
+  }
+
+  void json_number_serialize(const JSONNumber& number, std::string& output) {
+    json_number_serialize<std::string>(number, output);
+  }
+
+  void json_number_serialize(const JSONNumber& number, JSONWriter& output) {
+    json_number_serialize<JSONWriter>(number, output);
+  }
+
+  template<class Output>
+  void json_literal_serialize(const JSONLiteral& literal, Output& output) { 
     std::visit(overloaded {
       [&output](const JSONNumber& number) { json_number_serialize(number, output); },
       [&output](const std::nullptr_t nptr) {
         (void)nptr;
-        output += "null";
+        out_write(output, "null");
       },
       [&output](const bool boolean) {
-        output += boolean ? "true" : "false";
+        out_write(output, boolean ? "true" : "false");
       },
-      [&output](const std::string& str) {
+      [&output](const JSONString& str) {
         json_string_serialize(str, output);
       }
     }, literal);
   }
 
-  void prettify(const JSONValue& json, unsigned int depth, std::string& output) {
+  template<class Output>
+  void prettify(const JSONValue& json, unsigned int depth, Output& output) {
     if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH) {
       throw std::runtime_error("[jsxxn::prettify] Exceeded max nesting "
       "depth of " + std::to_string(JSXXN_IMPL_MAX_NESTING_DEPTH));
@@ -117,82 +254,191 @@ namespace jsxxn {
       },
       [&output, depth](const JSONObject& object) {
         if (object.size() == 0) {
-          output += "{}";
+          out_write(output, "{}");
           return;
         }
-        output += "{\n";
+        out_write(output, "{\n");
 
         JSONObject::size_type i = 0;
-        for (const std::pair<const std::string, JSON>& entry : object) {
-          output.append((depth + 1) * 2, ' ');
+        for (const JSONObject::value_type& entry : object) {
+          out_fill(output, (depth + 1) * 2, ' ');
           json_string_serialize(entry.first, output); 
-          output += ": "; 
+          out_write(output, ": "); 
           prettify(entry.second.value, depth + 1, output);
-          if (i != object.size() - 1) output += ", ";
-          output.push_back('\n');
+          if (i != object.size() - 1) out_write(output, ", ");
+          out_put(output, '\n');
           i++;
         }
 
-        output.append(depth * 2, ' ');
-        output.push_back('}');
+        out_fill(output, depth * 2, ' ');
+        out_put(output, '}');
       },
       [&output, depth](const JSONArray& arr) {
         if (arr.size() == 0) {
-          output += "[]";
+          out_write(output, "[]");
           return;
         }
 
-        output += "[\n";
+        out_write(output, "[\n");
         for (JSONArray::size_type i = 0; i < arr.size(); i++) {
-          output.append((depth + 1) * 2, ' ');
+          out_fill(output, (depth + 1) * 2, ' ');
           prettify(arr[i].value, depth + 1, output);
-          if (i != arr.size() - 1) output += ", ";
-          output.push_back('\n');
+          if (i != arr.size() - 1) out_write(output, ", ");
+          out_put(output, '\n');
         }
 
-        output.append(depth * 2, ' ');
-        output.push_back(']');
+        out_fill(output, depth * 2, ' ');
+        out_put(output, ']');
       }
     }, json);
   }
 
-  void stringify(const JSONValue& json, unsigned int depth, std::string& output) {
+  template<class Output>
+  void stringify(const JSONValue& json, unsigned int depth, Output& output) {
     if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH) {
       throw std::runtime_error("[jsxxn::prettify] Exceeded max nesting "
       "depth of " + std::to_string(JSXXN_IMPL_MAX_NESTING_DEPTH));
     }
 
+    // separators are written before every member but the first, since a
+    // JSONWriter can't take back a trailing comma once it has been flushed
     std::visit(overloaded { 
       [&output](const JSONLiteral& literal) {
         json_literal_serialize(literal, output);
       },
       [&output, depth](const JSONObject& object) {
-        output.push_back('{');
+        out_put(output, '{');
 
-        for (const std::pair<const std::string, JSON>& entry : object) {
+        bool first = true;
+        for (const JSONObject::value_type& entry : object) {
+          if (!first) out_put(output, ',');
+          first = false;
           json_string_serialize(entry.first, output); 
-          output.push_back(':'); 
+          out_put(output, ':'); 
           stringify(entry.second.value, depth + 1, output);
-          output.push_back(',');
         }
 
-        if (output[output.size() - 1] == ',')
-          output.resize(output.size() - 1);
-        output.push_back('}');
+        out_put(output, '}');
       },
       [&output, depth](const JSONArray& arr) {
-        output.push_back('[');
+        out_put(output, '[');
 
         for (JSONArray::size_type i = 0; i < arr.size(); i++) {
+          if (i != 0) out_put(output, ',');
           stringify(arr[i].value, depth + 1, output);
-          output.push_back(',');
         }
 
-        if (output[output.size() - 1] == ',')
-          output.resize(output.size() - 1);
+        out_put(output, ']');
+      }
+    }, json);
+  }
+
+  /**
+   * Large containers are split into this many chunks per thread, so that a
+   * few slow chunks (long strings, deep members) don't leave the other
+   * threads idle at the end
+  */
+  constexpr std::size_t STRINGIFY_CHUNKS_PER_THREAD = 8;
+
+  /**
+   * Stringifies the size members starting at begin as comma separated
+   * chunks on a thread pool, then joins the chunks onto output in order.
+   * write_member(it, out) writes the single member at it.
+  */
+  template<class Iterator, class WriteMember>
+  void stringify_members_parallel(Iterator begin, std::size_t size, unsigned int threads,
+    const WriteMember& write_member, std::string& output) {
+    const std::size_t chunks = std::min<std::size_t>(size, threads * STRINGIFY_CHUNKS_PER_THREAD);
+
+    // walked once up front, since object iterators aren't random access when
+    // objects are std::maps
+    std::vector<Iterator> bounds;
+    bounds.reserve(chunks + 1);
+    Iterator it = begin;
+    for (std::size_t c = 0; c < chunks; c++) {
+      bounds.push_back(it);
+      std::advance(it, size / chunks + (c < size % chunks));
+    }
+    bounds.push_back(it);
+
+    std::vector<std::string> parts(chunks);
+    parallel_for(chunks, threads, [&bounds, &parts, &write_member](std::size_t c) {
+      for (Iterator member = bounds[c]; member != bounds[c + 1]; ++member) {
+        if (member != bounds[c]) parts[c].push_back(',');
+        write_member(member, parts[c]);
+      }
+    });
+
+    std::size_t total = chunks - 1;
+    for (const std::string& part : parts) total += part.size();
+    output.reserve(output.size() + total);
+    for (std::size_t c = 0; c < chunks; c++) {
+      if (c != 0) output.push_back(',');
+      output += parts[c];
+    }
+  }
+
+  void stringify_parallel(const JSONValue& json, unsigned int depth, std::string& output,
+    unsigned int threads, std::size_t min_parallel_size) {
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH) {
+      throw std::runtime_error("[jsxxn::stringify_parallel] Exceeded max nesting "
+      "depth of " + std::to_string(JSXXN_IMPL_MAX_NESTING_DEPTH));
+    }
+
+    // containers too small to split are walked here on the calling thread,
+    // looking for large containers further down
+    std::visit(overloaded {
+      [&output](const JSONLiteral& literal) {
+        json_literal_serialize(literal, output);
+      },
+      [&output, depth, threads, min_parallel_size](const JSONObject& object) {
+        output.push_back('{');
+
+        if (object.size() >= min_parallel_size && threads > 1) {
+          stringify_members_parallel(object.begin(), object.size(), threads,
+            [depth](JSONObject::const_iterator entry, std::string& out) {
+              json_string_serialize(entry->first, out);
+              out.push_back(':');
+              stringify(entry->second.value, depth + 1, out);
+            }, output);
+        } else {
+          bool first = true;
+          for (const JSONObject::value_type& entry : object) {
+            if (!first) output.push_back(',');
+            first = false;
+            json_string_serialize(entry.first, output);
+            output.push_back(':');
+            stringify_parallel(entry.second.value, depth + 1, output, threads, min_parallel_size);
+          }
+        }
+
+        output.push_back('}');
+      },
+      [&output, depth, threads, min_parallel_size](const JSONArray& arr) {
+        output.push_back('[');
+
+        if (arr.size() >= min_parallel_size && threads > 1) {
+          stringify_members_parallel(arr.begin(), arr.size(), threads,
+            [depth](JSONArray::const_iterator elem, std::string& out) {
+              stringify(elem->value, depth + 1, out);
+            }, output);
+        } else {
+          for (JSONArray::size_type i = 0; i < arr.size(); i++) {
+            if (i != 0) output.push_back(',');
+            stringify_parallel(arr[i].value, depth + 1, output, threads, min_parallel_size);
+          }
+        }
+
         output.push_back(']');
       }
     }, json);
   }
 
-};
\ No newline at end of file
+  std::string stringify_parallel(const JSONValue& json, unsigned int threads, std::size_t min_parallel_size) {
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1U);
+    std::string output;
+    stringify_parallel(json, 0, output, threads, std::max<std::size_t>(min_parallel_size, 2));
+    return output;
+  }
+
+};
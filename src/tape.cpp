@@ -0,0 +1,512 @@
+#include "jsxxn_impl.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace jsxxn {
+
+  /**
+   * Tape layout, every integer in the writer's byte order:
+   *
+   *   header   TapeHeader
+   *   nodes    node_count TapeNodes, the tree in document order
+   *   index    index_count std::uint64_ts, lookup tables of large containers
+   *   strings  string_bytes bytes of string contents, not terminated
+   *
+   * A container's node is followed by its members, each an object's key
+   * (a TAPE_STRING node) and value, or an array's element, and its payload
+   * is the position of the node after its last member, so any value is
+   * stepped over in one hop. Containers with at least TAPE_INDEX_THRESHOLD
+   * members have a TAPE_INDEX node right after their own, pointing at count
+   * entries in the index: the node of each element for arrays, or the key
+   * node of each member sorted by key for objects.
+  */
+  enum TapeTag : std::uint32_t {
+    TAPE_NULL,
+    TAPE_FALSE,
+    TAPE_TRUE,
+    TAPE_INT, // payload is the int64_t's bits
+    TAPE_DOUBLE, // payload is the double's bits
+    TAPE_STRING, // payload is the offset into strings, count the length
+    TAPE_ARRAY, // count members, payload is the node after the last
+    TAPE_OBJECT, // count members, payload is the node after the last
+    TAPE_INDEX // payload is the offset of the lookup table into index
+  };
+
+  struct TapeNode {
+    std::uint32_t tag;
+    std::uint32_t count;
+    std::uint64_t payload;
+  };
+
+  struct TapeHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t node_count;
+    std::uint64_t index_count;
+    std::uint64_t string_bytes;
+  };
+
+  static_assert(sizeof(TapeNode) == 16);
+  static_assert(sizeof(TapeHeader) == 40);
+
+  constexpr char TAPE_MAGIC[8] = { 'j', 's', 'x', 'x', 'n', 't', 'p', '\0' };
+  constexpr std::uint32_t TAPE_VERSION = 1;
+  constexpr std::uint32_t TAPE_BYTE_ORDER = 0x01020304; // reads differently on the other byte order
+  constexpr std::uint32_t TAPE_INDEX_THRESHOLD = 16;
+
+  std::string err_tape_corrupt() {
+    return "[jsxxn::TapeDocument] corrupt tape";
+  }
+
+  struct TapeBuilder {
+    std::vector<TapeNode> nodes;
+    std::vector<std::uint64_t> index;
+    std::string strings;
+    std::unordered_map<std::string_view, std::uint64_t> keys; // views into the tree being written
+
+    std::uint32_t count(std::size_t size) {
+      if (size > UINT32_MAX)
+        throw std::runtime_error("[jsxxn::to_tape] string or container too large for a tape");
+      return static_cast<std::uint32_t>(size);
+    }
+
+    void add_string(std::string_view str) {
+      this->nodes.push_back(TapeNode{ TAPE_STRING, this->count(str.size()), this->strings.size() });
+      this->strings.append(str);
+    }
+
+    void add_key(std::string_view key) {
+      auto [it, inserted] = this->keys.emplace(key, this->strings.size());
+      if (inserted) this->strings.append(key);
+      this->nodes.push_back(TapeNode{ TAPE_STRING, this->count(key.size()), it->second });
+    }
+
+    std::string_view node_str(std::uint64_t node) const {
+      const TapeNode& n = this->nodes[node];
+      return std::string_view(this->strings).substr(n.payload, n.count);
+    }
+
+    /**
+     * Adds the node of a container with size members and, if it's large
+     * enough, its index node. Returns the offset of its lookup table, or
+     * index.size() if it has none.
+    */
+    std::size_t add_container(TapeTag tag, std::size_t size) {
+      this->nodes.push_back(TapeNode{ tag, this->count(size), 0 });
+      const std::size_t table = this->index.size();
+      if (size >= TAPE_INDEX_THRESHOLD) {
+        this->nodes.push_back(TapeNode{ TAPE_INDEX, 0, table });
+        this->index.resize(table + size);
+      }
+      return table;
+    }
+
+    void add(const JSONValue& json, unsigned int depth) {
+      if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH) {
+        throw std::runtime_error("[jsxxn::to_tape] Exceeded max nesting "
+        "depth of " + std::to_string(JSXXN_IMPL_MAX_NESTING_DEPTH));
+      }
+
+      std::visit(overloaded {
+        [this](const JSONLiteral& literal) {
+          std::visit(overloaded {
+            [this](std::nullptr_t) { this->nodes.push_back(TapeNode{ TAPE_NULL, 0, 0 }); },
+            [this](bool boolean) { this->nodes.push_back(TapeNode{ boolean ? TAPE_TRUE : TAPE_FALSE, 0, 0 }); },
+            [this](const JSONString& str) { this->add_string(str); },
+            [this](const JSONNumber& number) {
+              std::uint64_t bits;
+              if (number.index() == 0) {
+                std::int64_t num = std::get<std::int64_t>(number);
+                std::memcpy(&bits, &num, sizeof(bits));
+                this->nodes.push_back(TapeNode{ TAPE_INT, 0, bits });
+              } else {
+                double num = std::get<double>(number);
+                std::memcpy(&bits, &num, sizeof(bits));
+                this->nodes.push_back(TapeNode{ TAPE_DOUBLE, 0, bits });
+              }
+            }
+          }, literal);
+        },
+        [this, depth](const JSONObject& object) {
+          const std::size_t node = this->nodes.size();
+          const std::size_t table = this->add_container(TAPE_OBJECT, object.size());
+          const bool indexed = table != this->index.size();
+
+          std::size_t i = 0;
+          for (const JSONObject::value_type& entry : object) {
+            if (indexed) this->index[table + i++] = this->nodes.size();
+            this->add_key(entry.first);
+            this->add(entry.second.value, depth + 1);
+          }
+          if (indexed) {
+            std::sort(this->index.begin() + table, this->index.begin() + table + object.size(),
+              [this](std::uint64_t a, std::uint64_t b) { return this->node_str(a) < this->node_str(b); });
+          }
+          this->nodes[node].payload = this->nodes.size();
+        },
+        [this, depth](const JSONArray& arr) {
+          const std::size_t node = this->nodes.size();
+          const std::size_t table = this->add_container(TAPE_ARRAY, arr.size());
+          const bool indexed = table != this->index.size();
+
+          for (std::size_t i = 0; i < arr.size(); i++) {
+            if (indexed) this->index[table + i] = this->nodes.size();
+            this->add(arr[i].value, depth + 1);
+          }
+          this->nodes[node].payload = this->nodes.size();
+        }
+      }, json);
+    }
+  };
+
+  template<class Output>
+  void tape_write(const JSONValue& json, Output& output) {
+    TapeBuilder builder;
+    builder.add(json, 0);
+
+    TapeHeader header;
+    std::memcpy(header.magic, TAPE_MAGIC, sizeof(header.magic));
+    header.version = TAPE_VERSION;
+    header.byte_order = TAPE_BYTE_ORDER;
+    header.node_count = builder.nodes.size();
+    header.index_count = builder.index.size();
+    header.string_bytes = builder.strings.size();
+
+    out_write(output, reinterpret_cast<const char*>(&header), sizeof(header));
+    out_write(output, reinterpret_cast<const char*>(builder.nodes.data()), builder.nodes.size() * sizeof(TapeNode));
+    out_write(output, reinterpret_cast<const char*>(builder.index.data()), builder.index.size() * sizeof(std::uint64_t));
+    out_write(output, builder.strings);
+  }
+
+  std::string to_tape(const JSONValue& json) {
+    std::string output;
+    tape_write(json, output);
+    return output;
+  }
+
+  void to_tape(const JSONValue& json, JSONWriter& writer) {
+    tape_write(json, writer);
+  }
+
+  // Tapes are read with memcpy, since a tape in a std::string or at an odd
+  // offset of some buffer isn't necessarily aligned
+
+  inline TapeNode tape_node(const TapeData& tape, std::size_t node) {
+    if (node >= tape.node_count) throw std::runtime_error(err_tape_corrupt());
+    TapeNode n;
+    std::memcpy(&n, tape.nodes + node * sizeof(TapeNode), sizeof(TapeNode));
+    return n;
+  }
+
+  /**
+   * The node after the value at node
+  */
+  inline std::size_t tape_skip(const TapeData& tape, std::size_t node) {
+    const TapeNode n = tape_node(tape, node);
+    if (n.tag != TAPE_ARRAY && n.tag != TAPE_OBJECT) return node + 1;
+    if (n.payload <= node || n.payload > tape.node_count) throw std::runtime_error(err_tape_corrupt());
+    return static_cast<std::size_t>(n.payload);
+  }
+
+  /**
+   * Reads the container at node, checking that as many members as it claims
+   * fit between it and the node after it
+  */
+  TapeNode tape_container(const TapeData& tape, std::size_t node) {
+    const TapeNode n = tape_node(tape, node);
+    const std::size_t end = tape_skip(tape, node);
+    const std::size_t member_nodes = n.tag == TAPE_OBJECT ? 2 : 1;
+    if (n.count > (end - node - 1) / member_nodes) throw std::runtime_error(err_tape_corrupt());
+    return n;
+  }
+
+  /**
+   * The first member of the container at node
+  */
+  inline std::size_t tape_first(const TapeNode& n, std::size_t node) {
+    return n.count >= TAPE_INDEX_THRESHOLD ? node + 2 : node + 1;
+  }
+
+  /**
+   * Entry i of the lookup table of the container at node, which is checked
+   * to fall inside of the container
+  */
+  std::size_t tape_index_entry(const TapeData& tape, const TapeNode& n, std::size_t node, std::size_t i) {
+    const TapeNode table = tape_node(tape, node + 1);
+    if (table.tag != TAPE_INDEX || table.payload > tape.index_count || n.count > tape.index_count - table.payload)
+      throw std::runtime_error(err_tape_corrupt());
+
+    std::uint64_t entry;
+    std::memcpy(&entry, tape.index + (table.payload + i) * sizeof(std::uint64_t), sizeof(entry));
+    if (entry <= node + 1 || entry >= n.payload) throw std::runtime_error(err_tape_corrupt());
+    return static_cast<std::size_t>(entry);
+  }
+
+  std::string_view tape_string(const TapeData& tape, std::size_t node) {
+    const TapeNode n = tape_node(tape, node);
+    if (n.tag != TAPE_STRING || n.payload > tape.strings.size() || n.count > tape.strings.size() - n.payload)
+      throw std::runtime_error(err_tape_corrupt());
+    return tape.strings.substr(static_cast<std::size_t>(n.payload), n.count);
+  }
+
+  /**
+   * The value node of the member key of the object at node, or 0 (which is
+   * always the root) if there's no such member. Like parse, if a key is
+   * repeated the first member is found.
+  */
+  std::size_t tape_find_key(const TapeData& tape, std::size_t node, std::string_view key) {
+    if (tape_node(tape, node).tag != TAPE_OBJECT)
+      throw std::runtime_error("[TapeValue::at] searching key on non-object type");
+    const TapeNode n = tape_container(tape, node);
+
+    if (n.count >= TAPE_INDEX_THRESHOLD) {
+      std::size_t low = 0, high = n.count;
+      while (low < high) {
+        const std::size_t mid = low + (high - low) / 2;
+        if (tape_string(tape, tape_index_entry(tape, n, node, mid)) < key) low = mid + 1;
+        else high = mid;
+      }
+      if (low == n.count) return 0;
+      const std::size_t found = tape_index_entry(tape, n, node, low);
+      return tape_string(tape, found) == key ? found + 1 : 0;
+    }
+
+    std::size_t member = tape_first(n, node);
+    for (std::uint32_t i = 0; i < n.count; i++) {
+      if (tape_string(tape, member) == key) return member + 1;
+      member = tape_skip(tape, member + 1);
+    }
+    return 0;
+  }
+
+  JSONNumber tape_number(const TapeNode& n) {
+    if (n.tag == TAPE_INT) {
+      std::int64_t num;
+      std::memcpy(&num, &n.payload, sizeof(num));
+      return JSONNumber(num);
+    }
+    double num;
+    std::memcpy(&num, &n.payload, sizeof(num));
+    return JSONNumber(num);
+  }
+
+  JSON tape_to_json(const TapeData& tape, std::size_t node, unsigned int depth) {
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH)
+      throw std::runtime_error(err_max_nest());
+
+    const TapeNode n = tape_node(tape, node);
+    switch (n.tag) {
+      case TAPE_NULL: return JSON(nullptr);
+      case TAPE_FALSE: return JSON(false);
+      case TAPE_TRUE: return JSON(true);
+      case TAPE_INT:
+      case TAPE_DOUBLE: return JSON(tape_number(n));
+      case TAPE_STRING: return JSON(tape_string(tape, node));
+      case TAPE_ARRAY: {
+        tape_container(tape, node);
+        JSON arr(JSONArray{});
+        JSONArray& arrval = std::get<JSONArray>(arr.value);
+        arrval.reserve(n.count);
+        std::size_t element = tape_first(n, node);
+        for (std::uint32_t i = 0; i < n.count; i++) {
+          arrval.push_back(tape_to_json(tape, element, depth + 1));
+          element = tape_skip(tape, element);
+        }
+        return arr;
+      }
+      case TAPE_OBJECT: {
+        tape_container(tape, node);
+        JSON obj(JSONObject{});
+        JSONObject& objval = std::get<JSONObject>(obj.value);
+        #ifndef JSXXN_STD_MAP_OBJECT
+        objval.reserve(n.count);
+        #endif
+        std::size_t member = tape_first(n, node);
+        for (std::uint32_t i = 0; i < n.count; i++) {
+          std::string_view key = tape_string(tape, member);
+          objval.emplace(JSONString(key), tape_to_json(tape, member + 1, depth + 1));
+          member = tape_skip(tape, member + 1);
+        }
+        return obj;
+      }
+      default: throw std::runtime_error(err_tape_corrupt());
+    }
+  }
+
+  TapeValue::TapeValue(const TapeData& tape, std::size_t node) : tape(tape), node(node) {}
+
+  JSONValueType TapeValue::type() const {
+    return jsxxnt_to_jsont(this->xtype());
+  }
+
+  JSXXNValueType TapeValue::xtype() const {
+    switch (tape_node(this->tape, this->node).tag) {
+      case TAPE_NULL: return JSXXNValueType::NULLPTR;
+      case TAPE_FALSE:
+      case TAPE_TRUE: return JSXXNValueType::BOOLEAN;
+      case TAPE_INT: return JSXXNValueType::SINTEGER;
+      case TAPE_DOUBLE: return JSXXNValueType::DOUBLE;
+      case TAPE_STRING: return JSXXNValueType::STRING;
+      case TAPE_ARRAY: return JSXXNValueType::ARRAY;
+      case TAPE_OBJECT: return JSXXNValueType::OBJECT;
+      default: throw std::runtime_error(err_tape_corrupt());
+    }
+  }
+
+  TapeValue::operator bool() const {
+    const TapeNode n = tape_node(this->tape, this->node);
+    if (n.tag != TAPE_TRUE && n.tag != TAPE_FALSE)
+      throw std::runtime_error("[TapeValue::operator bool()] cannot cast "
+      "non-bool type to bool");
+    return n.tag == TAPE_TRUE;
+  }
+
+  TapeValue::operator double() const {
+    const TapeNode n = tape_node(this->tape, this->node);
+    if (n.tag != TAPE_INT && n.tag != TAPE_DOUBLE)
+      throw std::runtime_error("[TapeValue::operator double()] cannot cast "
+      "non-number type to double");
+    JSONNumber number = tape_number(n);
+    return number.index() == 0 ? static_cast<double>(std::get<std::int64_t>(number)) : std::get<double>(number);
+  }
+
+  TapeValue::operator std::int64_t() const {
+    const TapeNode n = tape_node(this->tape, this->node);
+    if (n.tag != TAPE_INT && n.tag != TAPE_DOUBLE)
+      throw std::runtime_error("[TapeValue::operator std::int64_t()] cannot cast "
+      "non-number type to std::int64_t");
+    JSONNumber number = tape_number(n);
+    return number.index() == 0 ? std::get<std::int64_t>(number) : static_cast<std::int64_t>(std::get<double>(number));
+  }
+
+  TapeValue::operator std::string_view() const {
+    if (tape_node(this->tape, this->node).tag != TAPE_STRING)
+      throw std::runtime_error("[TapeValue::operator std::string_view()] cannot cast "
+      "non-string type to std::string_view");
+    return tape_string(this->tape, this->node);
+  }
+
+  TapeValue TapeValue::at(std::string_view key) const {
+    const std::size_t value = tape_find_key(this->tape, this->node, key);
+    if (value == 0) throw std::runtime_error("[TapeValue::at] could not find key");
+    return TapeValue(this->tape, value);
+  }
+
+  bool TapeValue::contains(std::string_view key) const {
+    return tape_find_key(this->tape, this->node, key) != 0;
+  }
+
+  TapeValue TapeValue::at(std::size_t idx) const {
+    if (tape_node(this->tape, this->node).tag != TAPE_ARRAY)
+      throw std::runtime_error("[TapeValue::at] indexing non-array type");
+    const TapeNode n = tape_container(this->tape, this->node);
+    if (idx >= n.count)
+      throw std::out_of_range("[TapeValue::at] index out of range");
+
+    if (n.count >= TAPE_INDEX_THRESHOLD)
+      return TapeValue(this->tape, tape_index_entry(this->tape, n, this->node, idx));
+
+    std::size_t element = tape_first(n, this->node);
+    for (std::size_t i = 0; i < idx; i++)
+      element = tape_skip(this->tape, element);
+    return TapeValue(this->tape, element);
+  }
+
+  std::size_t TapeValue::size() const {
+    const TapeNode n = tape_node(this->tape, this->node);
+    if (n.tag != TAPE_ARRAY && n.tag != TAPE_OBJECT)
+      throw std::runtime_error("[TapeValue::size] queried non-container type");
+    return n.count;
+  }
+
+  TapeIterator TapeValue::begin() const {
+    const TapeNode n = tape_node(this->tape, this->node);
+    if (n.tag != TAPE_ARRAY && n.tag != TAPE_OBJECT)
+      throw std::runtime_error("[TapeValue::begin] iterating non-container type");
+    return TapeIterator(this->tape, tape_first(n, this->node), n.tag == TAPE_OBJECT);
+  }
+
+  TapeIterator TapeValue::end() const {
+    const TapeNode n = tape_node(this->tape, this->node);
+    return TapeIterator(this->tape, tape_skip(this->tape, this->node), n.tag == TAPE_OBJECT);
+  }
+
+  JSON TapeValue::to_json() const {
+    return tape_to_json(this->tape, this->node, 0);
+  }
+
+  TapeDocument::TapeDocument(std::string_view data) : file(nullptr), tape() {
+    TapeHeader header;
+    if (data.size() < sizeof(header))
+      throw std::runtime_error("[jsxxn::TapeDocument] data is too short to be a tape");
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, TAPE_MAGIC, sizeof(header.magic)) != 0)
+      throw std::runtime_error("[jsxxn::TapeDocument] data is not a tape");
+    if (header.byte_order != TAPE_BYTE_ORDER)
+      throw std::runtime_error("[jsxxn::TapeDocument] tape was written on a machine of the other byte order");
+    if (header.version != TAPE_VERSION)
+      throw std::runtime_error("[jsxxn::TapeDocument] unsupported tape version " + std::to_string(header.version));
+
+    // checked a section at a time so that huge counts can't overflow
+    std::size_t rest = data.size() - sizeof(header);
+    if (header.node_count == 0 || header.node_count > rest / sizeof(TapeNode))
+      throw std::runtime_error(err_tape_corrupt());
+    rest -= static_cast<std::size_t>(header.node_count) * sizeof(TapeNode);
+    if (header.index_count > rest / sizeof(std::uint64_t))
+      throw std::runtime_error(err_tape_corrupt());
+    rest -= static_cast<std::size_t>(header.index_count) * sizeof(std::uint64_t);
+    if (header.string_bytes != rest)
+      throw std::runtime_error(err_tape_corrupt());
+
+    this->tape.nodes = data.data() + sizeof(header);
+    this->tape.node_count = static_cast<std::size_t>(header.node_count);
+    this->tape.index = this->tape.nodes + this->tape.node_count * sizeof(TapeNode);
+    this->tape.index_count = static_cast<std::size_t>(header.index_count);
+    this->tape.strings = std::string_view(this->tape.index + this->tape.index_count * sizeof(std::uint64_t), rest);
+  }
+
+  TapeDocument TapeDocument::open(const std::string& path) {
+    std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>(path);
+    TapeDocument doc(file->view());
+    doc.file = std::move(file); // the view stays put when the file object moves
+    return doc;
+  }
+
+  TapeValue TapeDocument::root() const {
+    return TapeValue(this->tape, 0);
+  }
+
+  TapeIterator::TapeIterator(const TapeData& tape, std::size_t pos, bool is_object) :
+    tape(tape), pos(pos), is_object(is_object) {}
+
+  std::string_view TapeIterator::key() const {
+    if (!this->is_object)
+      throw std::runtime_error("[TapeIterator::key] iterating a non-object type");
+    return tape_string(this->tape, this->pos);
+  }
+
+  TapeValue TapeIterator::value() const {
+    return TapeValue(this->tape, this->is_object ? this->pos + 1 : this->pos);
+  }
+
+  TapeValue TapeIterator::operator*() const {
+    return this->value();
+  }
+
+  TapeIterator& TapeIterator::operator++() {
+    this->pos = tape_skip(this->tape, this->is_object ? this->pos + 1 : this->pos);
+    return *this;
+  }
+
+};
@@ -13,6 +13,10 @@
 #include <cfloat>
 #include <climits>
 #include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <algorithm>
 
 namespace jsxxn {
 
@@ -70,12 +74,33 @@ namespace jsxxn {
   Token tokenize_number(LexState& ls);
   Token tokenize_int(LexState& ls);
   Token tokenize_float(LexState& ls);
+  Token json_float_token(LexState& ls, std::size_t start, std::size_t end);
   Token tokenize_string(LexState& ls);
-  void consume_comments(LexState& ls);
+  bool skip_comments(LexState& ls);
   Token consume_keyword(LexState& ls, std::string_view keyword, TokenLiteral matched_type, TokenType matched_token_type);
 
 
   Token nextToken(LexState& ls) {
+    const Token token = lex_token(ls);
+    if (token.type == TokenType::ERROR)
+      throw std::runtime_error(parse_error_message(ls));
+    return token;
+  }
+
+  void consume_comments(LexState& ls) {
+    if (!skip_comments(ls))
+      throw std::runtime_error(parse_error_message(ls));
+  }
+
+  std::size_t skip_space(LexState& ls) {
+    while (true) {
+      ls.curr = scan_whitespace(ls.str, ls.curr);
+      if (ls.curr == ls.size || ls.str[ls.curr] != '/') return ls.curr;
+      consume_comments(ls);
+    }
+  }
+
+  Token lex_token(LexState& ls) {
     while (ls.curr < ls.size) {
       switch (ls.str[ls.curr]) {
         case '{': ls.curr++; return Token(TokenType::LEFT_BRACE, "{");
@@ -85,11 +110,11 @@ namespace jsxxn {
         case ']': ls.curr++; return Token(TokenType::RIGHT_BRACKET, "]");
         case ':': ls.curr++; return Token(TokenType::COLON, ":");
         case '"': return tokenize_string(ls);
-        case '/': consume_comments(ls); break;
+        case '/': if (!skip_comments(ls)) return Token(TokenType::ERROR, nullptr); break;
         case ' ':
         case '\r':
         case '\n':
-        case '\t': ls.curr++; break;
+        case '\t': ls.curr = scan_whitespace(ls.str, ls.curr + 1); break;
         case '.': // this is just going to be caught in tokenize_number as a leading decimal
         case '-':
         case '0':
@@ -105,25 +130,49 @@ namespace jsxxn {
         case 't': return consume_keyword(ls, "true", TokenLiteral(true), TokenType::TRUE);
         case 'f': return consume_keyword(ls, "false", TokenLiteral(false), TokenType::FALSE);
         case 'n': return consume_keyword(ls, "null", TokenLiteral(nullptr), TokenType::NULLPTR);
-        default: throw std::runtime_error(err_unhndled_char(ls.str, ls.curr));
+        default: return lex_fail(ls, ParseErrorCode::UNEXPECTED_CHARACTER, ls.curr, ls.curr);
       }
     }
 
     return Token(TokenType::END_OF_FILE, nullptr);
   }
 
-  std::vector<Token> tokenize(std::string_view str) {
-    std::vector<Token> res;
+  /**
+   * Expected input bytes per token, used to size the tape up front. Record
+   * shaped JSON averages 6 to 8 bytes per token and about a third of tokens
+   * are strings, so these overestimate a little for most input rather than
+   * grow the columns while tokenizing.
+  */
+  constexpr std::size_t TOKEN_TAPE_BYTES_PER_TOKEN = 4;
+  constexpr std::size_t TOKEN_TAPE_BYTES_PER_STRING = 12;
+  constexpr std::size_t TOKEN_TAPE_BYTES_PER_NUMBER = 16;
+
+  TokenTape tokenize(std::string_view str) {
+    TokenTape tape;
+    tape.types.reserve(str.size() / TOKEN_TAPE_BYTES_PER_TOKEN + 1);
+    tape.offsets.reserve(str.size() / TOKEN_TAPE_BYTES_PER_TOKEN + 1);
+    tape.strings.reserve(str.size() / TOKEN_TAPE_BYTES_PER_STRING);
+    tape.escaped.reserve(str.size() / TOKEN_TAPE_BYTES_PER_STRING);
+    tape.numbers.reserve(str.size() / TOKEN_TAPE_BYTES_PER_NUMBER);
     LexState ls(str);
 
-    Token token = nextToken(ls);
-    res.push_back(token);
-    while (token.type != TokenType::END_OF_FILE) {
-      token = nextToken(ls);
-      res.push_back(token); // note that we also push back eof on purpose!
+    while (true) {
+      // whitespace and comments are skipped first so that the token's start
+      // is known
+      tape.offsets.push_back(skip_space(ls));
+      const Token token = nextToken(ls);
+      tape.types.push_back(token.type);
+
+      switch (token.type) {
+        case TokenType::STRING: {
+          tape.strings.push_back(std::get<std::string_view>(token.val));
+          tape.escaped.push_back(token.escaped);
+        } break;
+        case TokenType::NUMBER: tape.numbers.push_back(std::get<JSONNumber>(token.val)); break;
+        case TokenType::END_OF_FILE: return tape; // kept on the tape on purpose!
+        default: break;
+      }
     }
-    
-    return res;
   }
 
   /**
@@ -149,19 +198,19 @@ namespace jsxxn {
     lookahead += ls.str[lookahead] == '-'; // consume -
 
     if ((stridx(ls.str, lookahead)) == '.')
-      throw std::runtime_error(err_deci_no_int(ls.str, start, lookahead));
+      return lex_fail(ls, ParseErrorCode::NUMBER_LEADING_DECIMAL, start, lookahead);
 
     if (!std::isdigit(stridx(ls.str, lookahead)))
-      throw std::runtime_error(err_no_int_part(ls.str, start, lookahead));
+      return lex_fail(ls, ParseErrorCode::NUMBER_NO_INTEGER_PART, start, lookahead);
 
     if (ls.str[lookahead] == '0' && std::isdigit(stridx(ls.str, lookahead + 1)))
-      throw std::runtime_error(err_lead_zeros(ls.str, start, lookahead + 1)); 
+      return lex_fail(ls, ParseErrorCode::NUMBER_LEADING_ZEROS, start, lookahead + 1);
 
     for (; lookahead < ls.size && std::isdigit(ls.str[lookahead]); lookahead++); // consume integer part
 
     if (stridx(ls.str, lookahead) == '.') { // float handling
       if (!std::isdigit(stridx(ls.str, lookahead + 1)))
-        throw std::runtime_error(err_trailing_dec(ls.str, start, lookahead));
+        return lex_fail(ls, ParseErrorCode::NUMBER_TRAILING_DECIMAL, start, lookahead);
       return tokenize_float(ls);
     }
 
@@ -181,7 +230,7 @@ namespace jsxxn {
         case '4': case '5': case '6': case '7': case '8':
         case '9': return tokenize_int(ls);
         default:
-          throw std::runtime_error(err_exp_inval_ch(ls.str, start, lookahead));
+          return lex_fail(ls, ParseErrorCode::NUMBER_INVALID_EXPONENT, start, lookahead);
       }
     }
 
@@ -190,6 +239,47 @@ namespace jsxxn {
     return tokenize_int(ls);
   }
 
+  #if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+    #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      #define JSXXN_SWAR_DIGITS
+    #endif
+  #elif defined(_WIN32)
+    #define JSXXN_SWAR_DIGITS
+  #endif
+
+  #ifdef JSXXN_SWAR_DIGITS
+  /**
+   * Converts 8 ascii digits to their value at once, by treating them as a
+   * single 64-bit integer (SWAR: SIMD within a register). Each step
+   * combines neighboring lanes: 8 one-digit lanes into 4 two-digit lanes,
+   * then into 2 four-digit lanes, then into the final eight-digit value.
+   *
+   * Assumes a little-endian machine, so the first digit is the lowest byte.
+  */
+  inline std::uint64_t swar_eight_digits(const char* digits) {
+    std::uint64_t val;
+    std::memcpy(&val, digits, sizeof(val));
+    val = ((val & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+    val = ((val & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    return ((val & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+  }
+  #endif
+
+  /**
+   * Value of n (n <= 19) ascii digits. The caller guarantees that the digits
+   * are valid and that the value cannot overflow a std::uint64_t.
+  */
+  inline std::uint64_t digits_value(const char* digits, std::size_t n) {
+    std::uint64_t num = 0;
+    #ifdef JSXXN_SWAR_DIGITS
+    for (; n >= 8; n -= 8, digits += 8)
+      num = num * 100000000ULL + swar_eight_digits(digits);
+    #endif
+    for (; n > 0; n--, digits++)
+      num = num * 10 + static_cast<std::uint64_t>(*digits - '0');
+    return num;
+  }
+
   /**
    * This function is only called from within tokenize_number whever
    * these conditions are met:
@@ -204,20 +294,32 @@ namespace jsxxn {
    * 64-bit signed integer
   */
   Token tokenize_int(LexState& ls) {
-    const std::size_t start = ls.curr; // 
-    std::int64_t num = 0LL;
+    // 10^18 - 1 is the largest run of nines which fits in a std::int64_t, so
+    // anything up to 18 digits can be read without checking for overflow
+    constexpr std::size_t MAX_SAFE_DIGITS = 18;
+    const std::size_t start = ls.curr;
+    const bool negative = ls.str[ls.curr] == '-';
+    ls.curr += negative;
 
-    // std::int64_t sign = 1LL * (-1LL * (ls.str[ls.curr] == '-'));
-    std::int64_t sign = 1LL + (-2LL * (ls.str[ls.curr] == '-'));
-    ls.curr += ls.str[ls.curr] == '-';
+    const std::size_t digits_start = ls.curr;
+    for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++);
+    const std::size_t ndigits = ls.curr - digits_start;
 
-    for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++) {
-      std::int64_t digit = (ls.str[ls.curr] - '0');
-      if ((INT64_MAX - digit) / 10LL <= num) {
+    if (ndigits > MAX_SAFE_DIGITS + 1) {
+      ls.curr = start;
+      return tokenize_float(ls);
+    }
+
+    std::int64_t num = 0LL;
+    if (ndigits <= MAX_SAFE_DIGITS) {
+      num = static_cast<std::int64_t>(digits_value(ls.str.data() + digits_start, ndigits));
+    } else { // exactly 19 digits, which may or may not fit
+      num = static_cast<std::int64_t>(digits_value(ls.str.data() + digits_start, MAX_SAFE_DIGITS));
+      std::int64_t digit = ls.str[digits_start + MAX_SAFE_DIGITS] - '0';
+      if ((INT64_MAX - digit) / 10LL < num) {
         ls.curr = start;
         return tokenize_float(ls); 
       }
-
       num = num * 10LL + digit;
     }
 
@@ -232,7 +334,7 @@ namespace jsxxn {
       ls.curr += stridx(ls.str, ls.curr) == '+';
 
       if (!std::isdigit(stridx(ls.str, ls.curr)))
-        throw std::runtime_error(err_missing_exp_part(ls.str, start, ls.curr));
+        return lex_fail(ls, ParseErrorCode::NUMBER_MISSING_EXPONENT, start, ls.curr);
 
       for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++) {
         exponential = exponential * 10 + (ls.str[ls.curr] - '0');
@@ -252,77 +354,168 @@ namespace jsxxn {
       }
     }
 
-    num *= sign;
+    num = negative ? -num : num;
     return Token(TokenType::NUMBER, JSONNumber(num));
   }
 
+  /**
+   * Reads the number starting at ls.curr as a double. The number's syntax
+   * up to its exponential part has already been checked by tokenize_number,
+   * so this only finds where the number ends (checking the exponential part
+   * on the way) and then converts the whole range at once with
+   * json_float_value
+  */
   Token tokenize_float(LexState& ls) {
     const std::size_t start = ls.curr;
-    double num = 0.0;
-    int sign = 1 + (-2 * (ls.str[ls.curr] == '-'));
     ls.curr += ls.str[ls.curr] == '-'; 
 
+    // integer part
+    for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++);
+
+    if (stridx(ls.str, ls.curr) == '.') { // fractional part
+      ls.curr++; // consume decimal
+      for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++);
+    }
+
+    // exponential part
+    if (stridx(ls.str, ls.curr) == 'e' || stridx(ls.str, ls.curr) == 'E') {
+      ls.curr++;
+      ls.curr += stridx(ls.str, ls.curr) == '-' || stridx(ls.str, ls.curr) == '+';
+
+      if (!std::isdigit(stridx(ls.str, ls.curr)))
+        return lex_fail(ls, ParseErrorCode::NUMBER_MISSING_EXPONENT, start, ls.curr);
+      for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++);
+    }
+
+    return json_float_token(ls, start, ls.curr);
+  }
+
+  #if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  /**
+   * Base 10 exponent of the leading digit of a valid JSON number, clamped to
+   * stay far away from overflowing. (Ex: "0.05" -> -2, "12.5e3" -> 4)
+   * Used to tell apart numbers which are too large to fit in a double from
+   * ones which are just too small, since std::from_chars reports both as
+   * out of range.
+  */
+  long float_magnitude(std::string_view num) {
+    constexpr long EXP_CLAMP = 100000;
+    const std::size_t mant_start = num[0] == '-';
+    const std::size_t mant_end = std::min(num.find_first_of("eE"), num.size());
+    const std::string_view mant = num.substr(mant_start, mant_end - mant_start);
+    const std::size_t dot = std::min(mant.find('.'), mant.size());
+
+    long magnitude = 0;
+    if (mant[0] != '0') { // JSON integer parts have no leading zeros
+      magnitude = static_cast<long>(std::min<std::size_t>(dot - 1, EXP_CLAMP));
+    } else { // 0.000ddd: the first nonzero digit of the fraction leads
+      std::size_t first = std::min(mant.find_first_not_of('0', dot + 1), mant.size());
+      magnitude = -static_cast<long>(std::min<std::size_t>(first - dot, EXP_CLAMP));
+    }
+
+    if (mant_end < num.size()) {
+      std::size_t i = mant_end + 1;
+      bool minus = num[i] == '-';
+      i += num[i] == '-' || num[i] == '+';
+      long exponential = 0;
+      for (; i < num.size(); i++)
+        exponential = std::min(exponential * 10 + (num[i] - '0'), EXP_CLAMP);
+      magnitude += minus ? -exponential : exponential;
+    }
+
+    return magnitude;
+  }
+
+  /**
+   * std::from_chars is exact (correctly rounded), and is implemented with
+   * fast paths like Eisel-Lemire in modern standard libraries
+  */
+  Token json_float_token(LexState& ls, std::size_t start, std::size_t end) {
+    double num = 0.0;
+    std::from_chars_result res = std::from_chars(ls.str.data() + start, ls.str.data() + end, num);
+    if (res.ec == std::errc::result_out_of_range) {
+      std::string_view text = ls.str.substr(start, end - start);
+      if (float_magnitude(text) >= 0)
+        return lex_fail(ls, ParseErrorCode::NUMBER_TOO_LARGE, start, end);
+      num = text[0] == '-' ? -0.0 : 0.0; // underflow, rounds to zero
+    }
+    return Token(TokenType::NUMBER, JSONNumber(num));
+  }
+  #else
+  /**
+   * Fallback for standard libraries without floating point std::from_chars.
+   * Note that this is not correctly rounded in all cases.
+  */
+  Token json_float_token(LexState& ls, std::size_t start, std::size_t end) {
+    const std::string_view v = ls.str;
+    std::size_t curr = start;
+    double num = 0.0;
+    int sign = 1 + (-2 * (v[curr] == '-'));
+    curr += v[curr] == '-'; 
+
     // read integer part
-    for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++) {
-      double digit = (ls.str[ls.curr] - '0');
+    for (; curr < end && std::isdigit(v[curr]); curr++) {
+      double digit = (v[curr] - '0');
       if ((DBL_MAX - digit) / 10.0 <= num)
-        throw std::runtime_error(err_num_overflow(ls.str, start, ls.curr));
+        return lex_fail(ls, ParseErrorCode::NUMBER_TOO_LARGE, start, curr);
       num = num * 10.0 + digit;
     }
 
-    if (stridx(ls.str, ls.curr) == '.') { // read fractional part
-      ls.curr++; // consume decimal
+    if (stridx(v, curr) == '.') { // read fractional part
+      curr++; // consume decimal
       double frac_mult = 0.1;
-      for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++) {
-        num += (ls.str[ls.curr] - '0') * frac_mult;
+      for (; curr < end && std::isdigit(v[curr]); curr++) {
+        num += (v[curr] - '0') * frac_mult;
         frac_mult /= 10;
       }
     }
 
     // read exponential part
-    if (stridx(ls.str, ls.curr) == 'e' || stridx(ls.str, ls.curr) == 'E') {
-      ls.curr++;
+    if (curr < end && (v[curr] == 'e' || v[curr] == 'E')) {
+      curr++;
       constexpr int MAX_EXPONENTIAL = 308;
       unsigned int exponential = 0;
-      bool minus = stridx(ls.str, ls.curr) == '-';
-      ls.curr += minus || stridx(ls.str, ls.curr) == '+';
+      bool minus = v[curr] == '-';
+      curr += minus || v[curr] == '+';
 
-      if (!std::isdigit(stridx(ls.str, ls.curr)))
-        throw std::runtime_error(err_missing_exp_part(ls.str, start, ls.curr));
-
-      for (; ls.curr < ls.size && std::isdigit(ls.str[ls.curr]); ls.curr++) {
-        exponential = exponential * 10 + (ls.str[ls.curr] - '0');
+      for (; curr < end && std::isdigit(v[curr]); curr++) {
+        exponential = exponential * 10 + (v[curr] - '0');
+        if (exponential > MAX_EXPONENTIAL)
+          return lex_fail(ls, ParseErrorCode::NUMBER_TOO_LARGE, start, end);
       }
 
-      if (exponential > MAX_EXPONENTIAL)
-        throw std::runtime_error(err_num_overflow(ls.str, start, ls.curr));
-
       if (minus) { 
         for (; exponential != 0; exponential--) num *= 0.1;
       } else {
         for (; exponential != 0; exponential--) {
           if (DBL_MAX / 10 <= num)
-            throw std::runtime_error(err_num_overflow(ls.str, start, ls.curr));
+            return lex_fail(ls, ParseErrorCode::NUMBER_TOO_LARGE, start, end);
           num *= 10;
         }
       }
     }
 
-    num *= sign;
-    return Token(TokenType::NUMBER, JSONNumber(num));
+    return Token(TokenType::NUMBER, JSONNumber(num * sign));
   }
+  #endif
 
   Token tokenize_string(LexState& ls) {
     ls.curr++; // consume quotation
     const std::size_t start = ls.curr;
     bool closed = false;
+    bool escaped = false;
 
     while (!closed && ls.curr < ls.size) {
+      // jump over the plain characters, straight to the next quotation mark,
+      // backslash, or control character
+      ls.curr = scan_string_body(ls.str, ls.curr);
+      if (ls.curr >= ls.size) break;
       char ch = ls.str[ls.curr];
       switch (ch) {
         case '"': ls.curr++; closed = true; break; // consume final '"'
         // escape handling should be handed to the parser?
         case '\\': {
+          escaped = true;
           char next = stridx(ls.str, ls.curr + 1);
           switch (next) {
             case '"': 
@@ -338,23 +531,23 @@ namespace jsxxn {
               ls.curr += 2; // consume backslash and u
 
               if (ls.curr + 4 > ls.size)
-                throw std::runtime_error(err_incmpl_hex(ls.str, ustart, ls.size));
+                return lex_fail(ls, ParseErrorCode::STRING_INCOMPLETE_HEX, ustart, ls.size);
 
               for (std::size_t i = 0; i < 4; i++) {
                 if (!std::isxdigit(ls.str[ls.curr + i]))
-                  throw std::runtime_error(err_inval_hex(ls.str, ustart, ls.curr + i));
+                  return lex_fail(ls, ParseErrorCode::STRING_INVALID_HEX, ustart, ls.curr + i);
               }
               
               ls.curr += 4;
             } break;
             case '\0':
-              throw std::runtime_error(err_unesc_bkslsh(ls.str, ls.curr, ls.curr + 1));
+              return lex_fail(ls, ParseErrorCode::STRING_UNESCAPED_BACKSLASH, ls.curr, ls.curr + 1);
             default:
-              throw std::runtime_error(err_inval_esc_seq(ls.str, ls.curr, ls.curr + 1));
+              return lex_fail(ls, ParseErrorCode::STRING_INVALID_ESCAPE, ls.curr, ls.curr + 1);
           }
         } break; // case '\\':
         case '\r':
-        case '\n': throw std::runtime_error(err_unclsed_str(ls.str, start, ls.curr));
+        case '\n': return lex_fail(ls, ParseErrorCode::STRING_UNCLOSED, start, ls.curr);
         default: {
           /**
            * "All Unicode characters may be placed within the
@@ -364,7 +557,7 @@ namespace jsxxn {
            *  So technically DEL is allowed? That had to be a mistake but whatever
           */
           if (std::iscntrl(ch) && ch != 127) 
-            throw std::runtime_error(err_unesc_ctrl(ls.str, ls.curr));
+            return lex_fail(ls, ParseErrorCode::STRING_CONTROL_CHARACTER, ls.curr, ls.curr);
             
           ls.curr++;
         }
@@ -372,11 +565,15 @@ namespace jsxxn {
     }
 
     if (!closed)
-      throw std::runtime_error(err_unclsed_str(ls.str, start, ls.curr));
-    return Token(TokenType::STRING, ls.str.substr(start, ls.curr - start - 1));
+      return lex_fail(ls, ParseErrorCode::STRING_UNCLOSED, start, ls.curr);
+    return Token(TokenType::STRING, ls.str.substr(start, ls.curr - start - 1), escaped);
   }
 
-  void consume_comments(LexState& ls) {
+  /**
+   * Skips the comment starting at ls.curr, returning false (with the error
+   * recorded in ls) on a slash which doesn't start a comment
+  */
+  bool skip_comments(LexState& ls) {
     switch (stridx(ls.str, ls.curr + 1)) {
       case '/': for (; ls.curr < ls.size && ls.str[ls.curr] != '\n'; ls.curr++); break;
       case '*': for (; ls.curr + 1 < ls.size; ls.curr++) {
@@ -385,8 +582,10 @@ namespace jsxxn {
         }
       } break;
       default:
-        throw std::runtime_error(err_unhndled_slsh(ls.str, ls.curr));
+        lex_fail(ls, ParseErrorCode::INVALID_COMMENT, ls.curr, ls.curr);
+        return false;
     }
+    return true;
   }
 
   Token consume_keyword(LexState& ls, std::string_view keyword, TokenLiteral matched_type, TokenType matched_token_type) {
@@ -395,7 +594,7 @@ namespace jsxxn {
       return Token(matched_token_type, matched_type);
     }
 
-    throw std::runtime_error(err_kwrd_mismatch(ls.str, keyword, ls.curr));
+    return lex_fail(ls, ParseErrorCode::INVALID_KEYWORD, ls.curr, ls.curr + keyword.length());
   }
 
   bool exact_match(std::string_view str, std::string_view check, std::size_t start) {
@@ -443,6 +642,52 @@ namespace jsxxn {
     return ascii_decs[static_cast<std::uint8_t>(ch & 0xFF)];
   }
 
+  /**
+   * Errors about a token in the wrong place only record where the token
+   * starts, so the token is lexed again to be described
+  */
+  Token relex_token(std::string_view str, std::size_t start) {
+    LexState ls(str);
+    ls.curr = start;
+    return lex_token(ls);
+  }
+
+  std::string parse_error_message(ParseErrorCode code, std::string_view str, std::size_t start, std::size_t end) {
+    switch (code) {
+      case ParseErrorCode::NONE: return std::string();
+      case ParseErrorCode::UNEXPECTED_CHARACTER: return err_unhndled_char(str, start);
+      case ParseErrorCode::INVALID_KEYWORD: {
+        std::string_view keyword = str[start] == 't' ? "true" : str[start] == 'f' ? "false" : "null";
+        return err_kwrd_mismatch(str, keyword, start);
+      }
+      case ParseErrorCode::INVALID_COMMENT: return err_unhndled_slsh(str, start);
+      case ParseErrorCode::NUMBER_TOO_LARGE: return err_num_overflow(str, start, end);
+      case ParseErrorCode::NUMBER_NO_INTEGER_PART: return err_no_int_part(str, start, end);
+      case ParseErrorCode::NUMBER_LEADING_DECIMAL: return err_deci_no_int(str, start, end);
+      case ParseErrorCode::NUMBER_TRAILING_DECIMAL: return err_trailing_dec(str, start, end);
+      case ParseErrorCode::NUMBER_LEADING_ZEROS: return err_lead_zeros(str, start, end);
+      case ParseErrorCode::NUMBER_INVALID_EXPONENT: return err_exp_inval_ch(str, start, end);
+      case ParseErrorCode::NUMBER_MISSING_EXPONENT: return err_missing_exp_part(str, start, end);
+      case ParseErrorCode::STRING_UNCLOSED: return err_unclsed_str(str, start, end);
+      case ParseErrorCode::STRING_CONTROL_CHARACTER: return err_unesc_ctrl(str, start);
+      case ParseErrorCode::STRING_INVALID_ESCAPE: return err_inval_esc_seq(str, start, end);
+      case ParseErrorCode::STRING_UNESCAPED_BACKSLASH: return err_unesc_bkslsh(str, start, end);
+      case ParseErrorCode::STRING_INCOMPLETE_HEX: return err_incmpl_hex(str, start, end);
+      case ParseErrorCode::STRING_INVALID_HEX: return err_inval_hex(str, start, end);
+      case ParseErrorCode::EXPECTED_VALUE: return err_expect_json_val(relex_token(str, start));
+      case ParseErrorCode::UNEXPECTED_EOF: return err_got_eof();
+      case ParseErrorCode::EXPECTED_KEY: return err_expect_str_key(relex_token(str, start));
+      case ParseErrorCode::EXPECTED_COLON: return err_expect_colon(relex_token(str, start));
+      case ParseErrorCode::UNEXPECTED_ARRAY_TOKEN: return err_unex_arr_token(relex_token(str, start));
+      case ParseErrorCode::UNEXPECTED_OBJECT_TOKEN: return err_unex_sep_token(relex_token(str, start));
+      case ParseErrorCode::UNCLOSED_ARRAY: return err_unclsed_arr();
+      case ParseErrorCode::UNCLOSED_OBJECT: return err_unclsed_obj();
+      case ParseErrorCode::TRAILING_TOKENS: return err_not_single_val(relex_token(str, start));
+      case ParseErrorCode::MAX_NESTING_DEPTH: return err_max_nest();
+    }
+    return std::string();
+  }
+
   std::string err_unhndled_char(std::string_view v, std::size_t ind) {
     return "Unknown unhandled character: '" +
       std::string(interpret_utf8char(utf8gat(v, ind))) + "' at index " +
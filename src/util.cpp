@@ -44,55 +44,6 @@ namespace jsxxn {
     return JSONValueType::NULLPTR;
   }
 
-  JSONValueType json_literal_get_type(const JSONLiteral& literal) {
-    return std::visit(overloaded {
-      [](const bool val) { (void)val; return JSONValueType::BOOLEAN;  },
-      [](const std::nullptr_t val) { (void)val; return JSONValueType::NULLPTR; },
-      [](const std::string& val) { (void)val; return JSONValueType::STRING; },
-      [](const JSONNumber& number) { (void)number; return JSONValueType::NUMBER; }
-    }, literal);
-  }
-
-  
-
-  JSONValueType json_value_get_type(const JSONValue& value) {
-    return std::visit(overloaded { 
-      [](const JSONObject& obj) { (void)obj; return JSONValueType::OBJECT; },
-      [](const JSONArray& arr) { (void)arr; return JSONValueType::ARRAY; },
-      [](const JSONLiteral& literal) {
-        return json_literal_get_type(literal);
-      }
-    }, value);
-  }
-  
-  JSXXNValueType json_number_get_xtype(const JSONNumber& number) {
-    return std::visit(overloaded {
-      [](const std::int64_t num) { (void)num; return JSXXNValueType::SINTEGER; },
-      [](const double num) { (void) num; return JSXXNValueType::DOUBLE; }
-    }, number);
-  }
-
-  JSXXNValueType json_literal_get_xtype(const JSONLiteral& literal) {
-    return std::visit(overloaded {
-      [](const bool val) { (void)val; return JSXXNValueType::BOOLEAN;  },
-      [](const std::nullptr_t val) { (void)val; return JSXXNValueType::NULLPTR; },
-      [](const std::string& val) { (void)val; return JSXXNValueType::STRING; },
-      [](const JSONNumber& number) { return json_number_get_xtype(number); }
-    }, literal);
-  }
-
-
-  JSXXNValueType json_value_get_xtype(const JSONValue& value) {
-    return std::visit(overloaded { 
-      [](const JSONObject& obj) { (void)obj; return JSXXNValueType::OBJECT; },
-      [](const JSONArray& arr) { (void)arr; return JSXXNValueType::ARRAY; },
-      [](const JSONLiteral& literal) {
-        return json_literal_get_xtype(literal);
-      }
-    }, value);
-  }
-
-
   const char* json_token_type_cstr(TokenType tokenType) {
     switch (tokenType) {
       case TokenType::LEFT_BRACE: return "left brace";
@@ -107,6 +58,7 @@ namespace jsxxn {
       case TokenType::NUMBER: return "number";
       case TokenType::STRING: return "string";
       case TokenType::END_OF_FILE: return "end of file";
+      case TokenType::ERROR: return "error";
     }
     return "unknown";
   }
@@ -115,10 +67,16 @@ namespace jsxxn {
     return std::string(json_token_type_cstr(tokenType));
   }
 
-  std::string json_string_resolve(std::string_view v) {
-    std::string ret;
+  JSONString json_string_resolve(std::string_view v, std::pmr::memory_resource* resource) {
+    JSONString ret(resource);
+    json_string_resolve(v, ret);
+    return ret;
+  }
+
+  void json_string_resolve(std::string_view v, JSONString& ret) {
     const std::size_t vlen = v.length();
-    
+    ret.reserve(ret.size() + vlen); // escapes only ever shrink the resolved string
+
     std::size_t i = 0;
     while (i < vlen) {
       switch (v[i]) {
@@ -148,11 +106,14 @@ namespace jsxxn {
             default: i += 2; break; // not even worried about invalid escapes here fr. 
           }
         } break;
-        default: ret += v[i]; i++;
+        default: { // copy everything up to the next escape in one go
+          std::size_t next = v.find('\\', i);
+          if (next == std::string_view::npos) next = vlen;
+          ret.append(v.data() + i, next - i);
+          i = next;
+        }
       }
     }
-
-    return ret;
   }
 
   std::string json_token_literal_serialize(TokenLiteral literal) {
@@ -0,0 +1,145 @@
+#include "jsxxn_impl.h"
+
+#include <string_view>
+#include <cstddef>
+
+namespace jsxxn {
+
+  /**
+   * Follows the same grammar as the parser in parse.cpp and reports the same
+   * errors, but never builds anything: strings stay views into the input
+   * (their escapes are checked by the tokenizer, never resolved). Like the
+   * parser, the first error is recorded in ls and turns the current token
+   * into an ERROR token, which unwinds every rule by ordinary returns.
+  */
+  struct ValidateState {
+    LexState ls;
+    Token token;
+    std::size_t before; // where the lexer was before reading token
+
+    ValidateState(std::string_view v) : ls(LexState(v)), before(0) {
+      this->next(); // fetches first token!
+    }
+
+    void next() {
+      this->before = this->ls.curr;
+      this->token = lex_token(this->ls);
+    }
+
+    bool failed() const {
+      return this->token.type == TokenType::ERROR;
+    }
+
+    /**
+     * Records code at the current token, unless the current token is
+     * already an error
+    */
+    void fail(ParseErrorCode code) {
+      if (this->failed()) return;
+      this->token = token_fail(this->ls, code, this->before);
+    }
+  };
+
+  void validate_value(ValidateState& vs, unsigned int depth);
+
+  void validate_array(ValidateState& vs, unsigned int depth) {
+    // Array Grammar: "[" (value (, value)* )? "]"
+    vs.next(); // consume left bracket
+    if (vs.token.type == TokenType::RIGHT_BRACKET) {
+      vs.next(); // consume right bracket
+      return;
+    }
+
+    validate_value(vs, depth + 1);
+    while (vs.token.type != TokenType::RIGHT_BRACKET) {
+      switch (vs.token.type) {
+        case TokenType::COMMA: {
+          vs.next(); // consume comma
+          validate_value(vs, depth + 1);
+        } break;
+        case TokenType::END_OF_FILE: vs.fail(ParseErrorCode::UNCLOSED_ARRAY); return;
+        case TokenType::ERROR: return;
+        default: vs.fail(ParseErrorCode::UNEXPECTED_ARRAY_TOKEN); return;
+      }
+    }
+    vs.next(); // consume right bracket
+  }
+
+  // Grammar: STRING ":" value
+  void validate_object_pair(ValidateState& vs, unsigned int depth) {
+    if (vs.token.type != TokenType::STRING) {
+      vs.fail(ParseErrorCode::EXPECTED_KEY);
+      return;
+    }
+    vs.next();
+
+    if (vs.token.type != TokenType::COLON) {
+      vs.fail(ParseErrorCode::EXPECTED_COLON);
+      return;
+    }
+    vs.next(); // consume colon
+    validate_value(vs, depth + 1);
+  }
+
+  void validate_object(ValidateState& vs, unsigned int depth) {
+    // Object Grammar: "{" ( ( STRING ":" value ) (, STRING ":"" value)* )? "}"
+    vs.next(); // consume left curly brace
+    if (vs.token.type == TokenType::RIGHT_BRACE) {
+      vs.next(); // consume right curly brace
+      return;
+    }
+
+    validate_object_pair(vs, depth);
+    while (vs.token.type != TokenType::RIGHT_BRACE) {
+      switch (vs.token.type) {
+        case TokenType::COMMA: {
+          vs.next(); // consume comma
+          validate_object_pair(vs, depth);
+        } break;
+        case TokenType::END_OF_FILE: vs.fail(ParseErrorCode::UNCLOSED_OBJECT); return;
+        case TokenType::ERROR: return;
+        default: vs.fail(ParseErrorCode::UNEXPECTED_OBJECT_TOKEN); return;
+      }
+    }
+    vs.next(); // consume right curly brace
+  }
+
+  void validate_value(ValidateState& vs, unsigned int depth) {
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH) {
+      vs.fail(ParseErrorCode::MAX_NESTING_DEPTH);
+      return;
+    }
+
+    switch (vs.token.type) {
+      case TokenType::LEFT_BRACE: validate_object(vs, depth); return;
+      case TokenType::LEFT_BRACKET: validate_array(vs, depth); return;
+      case TokenType::TRUE:
+      case TokenType::FALSE:
+      case TokenType::NULLPTR:
+      case TokenType::NUMBER:
+      case TokenType::STRING: vs.next(); return;
+      case TokenType::END_OF_FILE: vs.fail(ParseErrorCode::UNEXPECTED_EOF); return;
+      case TokenType::ERROR: return;
+      case TokenType::RIGHT_BRACE:
+      case TokenType::RIGHT_BRACKET:
+      case TokenType::COLON:
+      case TokenType::COMMA: // error
+      default: vs.fail(ParseErrorCode::EXPECTED_VALUE); return;
+    }
+  }
+
+  JSONValidation validate(std::string_view str) {
+    ValidateState vs(str);
+    validate_value(vs, 0);
+    if (vs.token.type != TokenType::END_OF_FILE)
+      vs.fail(ParseErrorCode::TRAILING_TOKENS);
+
+    JSONValidation result;
+    if (vs.failed()) {
+      result.valid = false;
+      result.error = parse_error(vs.ls);
+    }
+    return result;
+  }
+
+};
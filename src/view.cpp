@@ -0,0 +1,415 @@
+#include "jsxxn_impl.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace jsxxn {
+
+  /**
+   * The nodes of a ViewDocument are laid out like a tape (see tape.cpp): the
+   * tree in document order, with a container's node followed by its members,
+   * each an object's key (a STRING node) and value, or an array's element.
+  */
+  struct ViewNode {
+    JSXXNValueType type;
+    std::size_t count; // members of a container, or length of a string
+    union {
+      bool boolean;
+      std::int64_t integer;
+      double floating;
+      const char* chars; // of a string
+      std::size_t end; // of a container, the node after its last member
+    };
+  };
+
+  /**
+   * Everything of a ViewDocument besides its text, kept behind one pointer
+   * so that values read out of the document survive it being moved.
+   *
+   * Keys are interned: keys holds every distinct key of the document once,
+   * and every key node views the copy in keys, so equal keys anywhere in the
+   * document have the same chars pointer.
+  */
+  struct ViewData {
+    std::vector<ViewNode> nodes;
+    std::pmr::monotonic_buffer_resource arena; // decoded escaped strings
+    std::vector<std::string_view> keys; // open addressing, a null data() is an empty slot
+    std::size_t key_count = 0;
+  };
+
+  /**
+   * The slot of keys holding key, or the empty slot where it would go
+  */
+  std::size_t view_key_slot(const std::vector<std::string_view>& keys, std::string_view key) {
+    const std::size_t mask = keys.size() - 1;
+    std::size_t slot = std::hash<std::string_view>{}(key) & mask;
+    while (keys[slot].data() != nullptr && keys[slot] != key) slot = (slot + 1) & mask;
+    return slot;
+  }
+
+  /**
+   * Copies str into the arena, for strings which don't view the text
+  */
+  std::string_view view_copy(ViewData& data, std::string_view str) {
+    char* copy = static_cast<char*>(data.arena.allocate(std::max<std::size_t>(str.size(), 1), 1));
+    std::copy(str.begin(), str.end(), copy);
+    return std::string_view(copy, str.size());
+  }
+
+  struct ViewParserState {
+    LexState ls;
+    Token token;
+    ViewData& data;
+    JSONString scratch; // reused for decoding escaped strings
+
+    ViewParserState(std::string_view v, ViewData& data) : ls(LexState(v)), data(data) {
+      this->next(); // fetches first token!
+    }
+
+    void next() {
+      this->token = nextToken(this->ls);
+    }
+
+    /**
+     * The current token's string, which is decoded into scratch if it's
+     * escaped and viewed in place otherwise
+    */
+    std::string_view token_str() {
+      std::string_view str = std::get<std::string_view>(this->token.val);
+      if (!this->token.escaped) return str;
+      this->scratch.clear();
+      json_string_resolve(str, this->scratch);
+      return this->scratch;
+    }
+
+    void push_string(std::string_view str) {
+      ViewNode node;
+      node.type = JSXXNValueType::STRING;
+      node.count = str.size();
+      node.chars = str.data();
+      this->data.nodes.push_back(node);
+    }
+
+    /**
+     * Adds a node for the current token, which must be a string. Escaped
+     * strings are decoded into the arena, the rest are viewed in place.
+    */
+    void push_value_string() {
+      std::string_view str = this->token_str();
+      this->push_string(this->token.escaped ? view_copy(this->data, str) : str);
+    }
+
+    /**
+     * Adds a node for the current token, which must be a key, viewing the
+     * document's one copy of that key. An escaped key is only decoded into
+     * the arena the first time it's seen.
+    */
+    void push_key() {
+      std::vector<std::string_view>& keys = this->data.keys;
+      if ((this->data.key_count + 1) * 2 > keys.size()) { // keep the table at most half full
+        std::vector<std::string_view> grown(std::max<std::size_t>(keys.size() * 2, 64));
+        for (std::string_view key : keys)
+          if (key.data() != nullptr) grown[view_key_slot(grown, key)] = key;
+        keys.swap(grown);
+      }
+
+      std::string_view str = this->token_str();
+      const std::size_t slot = view_key_slot(keys, str);
+      if (keys[slot].data() == nullptr) {
+        keys[slot] = this->token.escaped ? view_copy(this->data, str) : str;
+        this->data.key_count++;
+      }
+      this->push_string(keys[slot]);
+    }
+  };
+
+  void view_parse_value(ViewParserState& vs, unsigned int depth);
+
+  // Array Grammar: "[" (value (, value)* )? "]"
+  // Object Grammar: "{" ( ( STRING ":" value ) (, STRING ":"" value)* )? "}"
+  void view_parse_container(ViewParserState& vs, unsigned int depth, bool is_object) {
+    const std::size_t container = vs.data.nodes.size();
+    ViewNode node;
+    node.type = is_object ? JSXXNValueType::OBJECT : JSXXNValueType::ARRAY;
+    node.count = 0;
+    vs.data.nodes.push_back(node);
+
+    const TokenType close = is_object ? TokenType::RIGHT_BRACE : TokenType::RIGHT_BRACKET;
+    vs.next(); // consume left brace or bracket
+    std::size_t count = 0;
+    if (vs.token.type != close) {
+      while (true) {
+        if (is_object) {
+          if (vs.token.type != TokenType::STRING)
+            throw std::runtime_error(err_expect_str_key(vs.token));
+          vs.push_key();
+          vs.next();
+          if (vs.token.type != TokenType::COLON)
+            throw std::runtime_error(err_expect_colon(vs.token));
+          vs.next(); // consume colon
+        }
+        view_parse_value(vs, depth + 1);
+        count++;
+
+        if (vs.token.type == close) break;
+        switch (vs.token.type) {
+          case TokenType::COMMA: vs.next(); continue; // consume comma
+          case TokenType::END_OF_FILE:
+            throw std::runtime_error(is_object ? err_unclsed_obj() : err_unclsed_arr());
+          default:
+            throw std::runtime_error(is_object ? err_unex_sep_token(vs.token) : err_unex_arr_token(vs.token));
+        }
+      }
+    }
+
+    vs.data.nodes[container].count = count;
+    vs.data.nodes[container].end = vs.data.nodes.size();
+    vs.next(); // consume right brace or bracket
+  }
+
+  void view_parse_value(ViewParserState& vs, unsigned int depth) {
+    if (depth > JSXXN_IMPL_MAX_NESTING_DEPTH)
+      throw std::runtime_error(err_max_nest());
+
+    ViewNode node;
+    node.count = 0;
+    switch (vs.token.type) {
+      case TokenType::LEFT_BRACE: view_parse_container(vs, depth, true); return;
+      case TokenType::LEFT_BRACKET: view_parse_container(vs, depth, false); return;
+      case TokenType::STRING: vs.push_value_string(); vs.next(); return;
+      case TokenType::TRUE:
+      case TokenType::FALSE: {
+        node.type = JSXXNValueType::BOOLEAN;
+        node.boolean = vs.token.type == TokenType::TRUE;
+      } break;
+      case TokenType::NULLPTR: {
+        node.type = JSXXNValueType::NULLPTR;
+        node.integer = 0;
+      } break;
+      case TokenType::NUMBER: {
+        const JSONNumber& number = std::get<JSONNumber>(vs.token.val);
+        if (number.index() == 0) {
+          node.type = JSXXNValueType::SINTEGER;
+          node.integer = std::get<std::int64_t>(number);
+        } else {
+          node.type = JSXXNValueType::DOUBLE;
+          node.floating = std::get<double>(number);
+        }
+      } break;
+      case TokenType::END_OF_FILE: throw std::runtime_error(err_got_eof());
+      default: throw std::runtime_error(err_expect_json_val(vs.token));
+    }
+    vs.data.nodes.push_back(node);
+    vs.next();
+  }
+
+  /**
+   * The node after the value at node, skipping over everything inside of it
+  */
+  inline std::size_t view_skip(const ViewNode* nodes, std::size_t node) {
+    const JSXXNValueType type = nodes[node].type;
+    return type == JSXXNValueType::OBJECT || type == JSXXNValueType::ARRAY ? nodes[node].end : node + 1;
+  }
+
+  inline std::string_view view_string(const ViewNode& node) {
+    return std::string_view(node.chars, node.count);
+  }
+
+  /**
+   * The node of the value of the first member named key, or 0 if there is
+   * none (the root is never a member). key is looked up once among the
+   * document's keys, and members are then matched by pointer.
+  */
+  std::size_t view_find_key(const ViewData& data, std::size_t node, std::string_view key) {
+    const ViewNode* nodes = data.nodes.data();
+    if (nodes[node].type != JSXXNValueType::OBJECT)
+      throw std::runtime_error("[ViewValue::at] searching key on non-object type");
+    const char* interned = data.keys[view_key_slot(data.keys, key)].data();
+    if (interned == nullptr) return 0; // no object of the document has this key
+
+    std::size_t member = node + 1;
+    for (std::size_t i = 0; i < nodes[node].count; i++) {
+      if (nodes[member].chars == interned) return member + 1;
+      member = view_skip(nodes, member + 1);
+    }
+    return 0;
+  }
+
+  JSON view_to_json(const ViewNode* nodes, std::size_t node) {
+    const ViewNode& n = nodes[node];
+    switch (n.type) {
+      case JSXXNValueType::NULLPTR: return JSON(nullptr);
+      case JSXXNValueType::BOOLEAN: return JSON(n.boolean);
+      case JSXXNValueType::SINTEGER: return JSON(n.integer);
+      case JSXXNValueType::DOUBLE: return JSON(n.floating);
+      case JSXXNValueType::STRING: return JSON(view_string(n));
+      case JSXXNValueType::ARRAY: {
+        JSON arr(JSONArray{});
+        JSONArray& arrval = std::get<JSONArray>(arr.value);
+        arrval.reserve(n.count);
+        for (std::size_t element = node + 1; element < n.end; element = view_skip(nodes, element))
+          arrval.push_back(view_to_json(nodes, element));
+        return arr;
+      }
+      case JSXXNValueType::OBJECT: {
+        JSON obj(JSONObject{});
+        JSONObject& objval = std::get<JSONObject>(obj.value);
+        #ifndef JSXXN_STD_MAP_OBJECT
+        objval.reserve(n.count);
+        #endif
+        for (std::size_t member = node + 1; member < n.end; member = view_skip(nodes, member + 1))
+          objval.emplace(JSONString(view_string(nodes[member])), view_to_json(nodes, member + 1));
+        return obj;
+      }
+    }
+    return JSON();
+  }
+
+  ViewValue::ViewValue(const ViewData* data, std::size_t node) : data(data), node(node) {}
+
+  JSONValueType ViewValue::type() const {
+    return jsxxnt_to_jsont(this->xtype());
+  }
+
+  JSXXNValueType ViewValue::xtype() const {
+    return this->data->nodes[this->node].type;
+  }
+
+  ViewValue::operator bool() const {
+    const ViewNode& n = this->data->nodes[this->node];
+    if (n.type != JSXXNValueType::BOOLEAN)
+      throw std::runtime_error("[ViewValue::operator bool()] cannot cast "
+      "non-bool type to bool");
+    return n.boolean;
+  }
+
+  ViewValue::operator double() const {
+    const ViewNode& n = this->data->nodes[this->node];
+    switch (n.type) {
+      case JSXXNValueType::SINTEGER: return static_cast<double>(n.integer);
+      case JSXXNValueType::DOUBLE: return n.floating;
+      default: throw std::runtime_error("[ViewValue::operator double()] cannot cast "
+      "non-number type to double");
+    }
+  }
+
+  ViewValue::operator std::int64_t() const {
+    const ViewNode& n = this->data->nodes[this->node];
+    switch (n.type) {
+      case JSXXNValueType::SINTEGER: return n.integer;
+      case JSXXNValueType::DOUBLE: return static_cast<std::int64_t>(n.floating);
+      default: throw std::runtime_error("[ViewValue::operator std::int64_t()] cannot cast "
+      "non-number type to std::int64_t");
+    }
+  }
+
+  ViewValue::operator std::string_view() const {
+    const ViewNode& n = this->data->nodes[this->node];
+    if (n.type != JSXXNValueType::STRING)
+      throw std::runtime_error("[ViewValue::operator std::string_view()] cannot cast "
+      "non-string type to std::string_view");
+    return view_string(n);
+  }
+
+  ViewValue ViewValue::at(std::string_view key) const {
+    const std::size_t value = view_find_key(*this->data, this->node, key);
+    if (value == 0) throw std::runtime_error("[ViewValue::at] could not find key");
+    return ViewValue(this->data, value);
+  }
+
+  bool ViewValue::contains(std::string_view key) const {
+    return view_find_key(*this->data, this->node, key) != 0;
+  }
+
+  ViewValue ViewValue::at(std::size_t idx) const {
+    const ViewNode& n = this->data->nodes[this->node];
+    if (n.type != JSXXNValueType::ARRAY)
+      throw std::runtime_error("[ViewValue::at] indexing non-array type");
+    if (idx >= n.count)
+      throw std::out_of_range("[ViewValue::at] index out of range");
+
+    std::size_t element = this->node + 1;
+    for (std::size_t i = 0; i < idx; i++)
+      element = view_skip(this->data->nodes.data(), element);
+    return ViewValue(this->data, element);
+  }
+
+  std::size_t ViewValue::size() const {
+    const ViewNode& n = this->data->nodes[this->node];
+    if (n.type != JSXXNValueType::ARRAY && n.type != JSXXNValueType::OBJECT)
+      throw std::runtime_error("[ViewValue::size] queried non-container type");
+    return n.count;
+  }
+
+  ViewIterator ViewValue::begin() const {
+    const ViewNode& n = this->data->nodes[this->node];
+    if (n.type != JSXXNValueType::ARRAY && n.type != JSXXNValueType::OBJECT)
+      throw std::runtime_error("[ViewValue::begin] iterating non-container type");
+    return ViewIterator(this->data, this->node + 1, n.type == JSXXNValueType::OBJECT);
+  }
+
+  ViewIterator ViewValue::end() const {
+    const ViewNode& n = this->data->nodes[this->node];
+    return ViewIterator(this->data, view_skip(this->data->nodes.data(), this->node), n.type == JSXXNValueType::OBJECT);
+  }
+
+  JSON ViewValue::to_json() const {
+    return view_to_json(this->data->nodes.data(), this->node);
+  }
+
+  ViewIterator::ViewIterator(const ViewData* data, std::size_t pos, bool is_object) :
+    data(data), pos(pos), is_object(is_object) {}
+
+  std::string_view ViewIterator::key() const {
+    if (!this->is_object)
+      throw std::runtime_error("[ViewIterator::key] iterating a non-object type");
+    return view_string(this->data->nodes[this->pos]);
+  }
+
+  ViewValue ViewIterator::value() const {
+    return ViewValue(this->data, this->is_object ? this->pos + 1 : this->pos);
+  }
+
+  ViewValue ViewIterator::operator*() const {
+    return this->value();
+  }
+
+  ViewIterator& ViewIterator::operator++() {
+    this->pos = view_skip(this->data->nodes.data(), this->is_object ? this->pos + 1 : this->pos);
+    return *this;
+  }
+
+  ViewDocument::ViewDocument(std::string_view str) : data(std::make_unique<ViewData>()) {
+    this->parse(str);
+  }
+
+  ViewDocument::ViewDocument(std::string&& str) :
+    text(std::make_unique<std::string>(std::move(str))), data(std::make_unique<ViewData>()) {
+    this->parse(*this->text);
+  }
+
+  ViewDocument::ViewDocument(ViewDocument&& other) noexcept = default;
+  ViewDocument& ViewDocument::operator=(ViewDocument&& other) noexcept = default;
+  ViewDocument::~ViewDocument() = default;
+
+  void ViewDocument::parse(std::string_view str) {
+    this->data->keys.resize(64); // so that lookups always have a table, even without objects
+    ViewParserState vs(str, *this->data);
+    view_parse_value(vs, 0);
+    if (vs.token.type != TokenType::END_OF_FILE)
+      throw std::runtime_error(err_not_single_val(vs.token));
+  }
+
+  ViewValue ViewDocument::root() const {
+    return ViewValue(this->data.get(), 0);
+  }
+
+};
@@ -0,0 +1,96 @@
+#include "jsxxn.h"
+
+#include <stdexcept>
+#include <ostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <utility>
+#include <algorithm>
+
+#if defined(_WIN32)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace jsxxn {
+
+  JSONWriter::JSONWriter(Sink sink, std::size_t buffer_size) :
+    sink(std::move(sink)),
+    buffer(std::make_unique<char[]>(std::max<std::size_t>(buffer_size, 1))),
+    capacity(std::max<std::size_t>(buffer_size, 1)),
+    used(0) {}
+
+  JSONWriter::JSONWriter(std::FILE* file, std::size_t buffer_size) :
+    JSONWriter([file](const char* data, std::size_t size) {
+      if (std::fwrite(data, 1, size, file) != size)
+        throw std::runtime_error("[jsxxn::JSONWriter] could not write to FILE*");
+    }, buffer_size) {}
+
+  JSONWriter::JSONWriter(std::ostream& stream, std::size_t buffer_size) :
+    JSONWriter([&stream](const char* data, std::size_t size) {
+      if (!stream.write(data, static_cast<std::streamsize>(size)))
+        throw std::runtime_error("[jsxxn::JSONWriter] could not write to std::ostream");
+    }, buffer_size) {}
+
+  JSONWriter JSONWriter::to_fd(int fd, std::size_t buffer_size) {
+    return JSONWriter([fd](const char* data, std::size_t size) {
+      while (size > 0) {
+        #if defined(_WIN32)
+        int written = _write(fd, data, static_cast<unsigned int>(std::min<std::size_t>(size, 1U << 30)));
+        #else
+        ssize_t written = ::write(fd, data, size);
+        #endif
+        if (written < 0) {
+          if (errno == EINTR) continue;
+          throw std::runtime_error("[jsxxn::JSONWriter] could not write to file descriptor " +
+            std::to_string(fd) + ": " + std::strerror(errno));
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+      }
+    }, buffer_size);
+  }
+
+  JSONWriter::~JSONWriter() {
+    try {
+      this->flush();
+    } catch (...) {} // see flush() to handle errors
+  }
+
+  void JSONWriter::write(const char* data, std::size_t size) {
+    if (size <= this->capacity - this->used) {
+      std::memcpy(this->buffer.get() + this->used, data, size);
+      this->used += size;
+      return;
+    }
+
+    this->flush();
+    if (size >= this->capacity) { // wouldn't fit anyway, skip the copy
+      this->sink(data, size);
+      return;
+    }
+
+    std::memcpy(this->buffer.get(), data, size);
+    this->used = size;
+  }
+
+  void JSONWriter::fill(std::size_t count, char ch) {
+    while (count > 0) {
+      if (this->used == this->capacity) this->flush();
+      std::size_t n = std::min(count, this->capacity - this->used);
+      std::memset(this->buffer.get() + this->used, ch, n);
+      this->used += n;
+      count -= n;
+    }
+  }
+
+  void JSONWriter::flush() {
+    if (this->used == 0) return;
+    std::size_t size = this->used;
+    this->used = 0; // so a throwing sink doesn't get the same data twice
+    this->sink(this->buffer.get(), size);
+  }
+
+};
@@ -69,7 +69,7 @@ benchmark_data benchmark(std::string_view json_str) {
 
   try {
     TIMESTAMP(before_tokenize);
-    std::vector<jsxxn::Token> tokens = jsxxn::tokenize(json_str);
+    jsxxn::TokenTape tokens = jsxxn::tokenize(json_str);
     data.tok_t = SINCE(before_tokenize);
 
     TIMESTAMP(before_parse);
@@ -171,12 +171,6 @@ int main(int argc, char** argv) {
 }
 
 std::string read_file_to_string(std::string path) {
-  std::ifstream file(path);
-  if (file.bad() || !file.is_open())
-    throw std::runtime_error("File " + path + " could not be opened.");
-
-  std::string res;
-  std::string line;
-  while (std::getline(file, line)) res += line + '\n';
-  return res;
+  jsxxn::MappedFile file(path);
+  return std::string(file.view());
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "jsxxn.h"
+#include "jsxxn_reflect.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include <optional>
+#include <cstdint>
+
+namespace binding_test {
+
+  struct Point {
+    std::int64_t x = 0;
+    std::int64_t y = 0;
+  };
+  JSXXN_REFLECT(Point, x, y)
+
+  struct Shape {
+    std::string name;
+    std::vector<Point> points;
+    std::optional<double> area;
+    bool closed = false;
+    std::uint8_t layer = 0;
+    std::map<std::string, std::string> tags;
+    jsxxn::JSON extra;
+  };
+  JSXXN_REFLECT(Shape, name, points, area, closed, layer, tags, extra)
+
+};
+
+TEST_CASE("JSONReader", "[binding]") {
+  SECTION("Walks objects and arrays") {
+    jsxxn::JSONReader reader(R"({ "a": [1, "two", null], "b\n": { "c": true }, "d": 4 })");
+    std::string seen;
+    std::string_view key;
+
+    reader.begin_object();
+    REQUIRE(reader.next_key(key));
+    REQUIRE(key == "a");
+    reader.begin_array();
+    REQUIRE(reader.next_element());
+    REQUIRE(std::get<std::int64_t>(reader.read_number()) == 1);
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.read_string() == "two");
+    REQUIRE(reader.next_element());
+    reader.read_null();
+    REQUIRE_FALSE(reader.next_element());
+
+    REQUIRE(reader.next_key(key));
+    REQUIRE(key == "b\n");
+    REQUIRE(reader.read_raw() == R"({ "c": true })");
+    REQUIRE(reader.next_key(key));
+    REQUIRE(key == "d");
+    reader.skip();
+    REQUIRE_FALSE(reader.next_key(key));
+    reader.finish();
+  }
+
+  SECTION("Raw values leave out comments before them") {
+    jsxxn::JSONReader reader(R"([1, /* c */ {"a":2}, // line
+      "s" /* after */ ])");
+    reader.begin_array();
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.read_raw() == "1");
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.read_raw() == R"({"a":2})");
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.read_raw() == R"("s")");
+    REQUIRE_FALSE(reader.next_element());
+    reader.finish();
+  }
+
+  SECTION("Malformed input throws") {
+    auto skip_all = [](std::string_view str) {
+      jsxxn::JSONReader reader(str);
+      reader.skip();
+      reader.finish();
+    };
+    REQUIRE_NOTHROW(skip_all(R"({ "a": [1, {}, []] })"));
+    REQUIRE_THROWS_AS(skip_all("[1, 2,]"), std::runtime_error);
+    REQUIRE_THROWS_AS(skip_all(R"({ "a" 1 })"), std::runtime_error);
+    REQUIRE_THROWS_AS(skip_all(R"({ "a": 1 )"), std::runtime_error);
+    REQUIRE_THROWS_AS(skip_all("[1 2]"), std::runtime_error);
+    REQUIRE_THROWS_AS(skip_all("1 2"), std::runtime_error);
+    REQUIRE_THROWS_AS(skip_all(std::string(300, '[') + std::string(300, ']')), std::runtime_error);
+
+    jsxxn::JSONReader reader(R"("not a number")");
+    REQUIRE_THROWS_AS(reader.read_number(), std::runtime_error);
+  }
+}
+
+TEST_CASE("struct binding", "[binding]") {
+  const char* text = R"({
+    "name": "tri\"angle",
+    "unknown": { "skipped": [1, 2, 3] },
+    "points": [ { "x": 0, "y": 0 }, { "y": 4, "x": 3 }, { "x": -1, "x": 7 } ],
+    "area": 6.5,
+    "closed": true,
+    "layer": 3,
+    "tags": { "color": "red" },
+    "extra": [1, { "free": "form" }]
+  })";
+
+  SECTION("Decodes into structs") {
+    binding_test::Shape shape = jsxxn::bind_parse<binding_test::Shape>(text);
+    REQUIRE(shape.name == "tri\"angle");
+    REQUIRE(shape.points.size() == 3);
+    REQUIRE(shape.points[1].x == 3);
+    REQUIRE(shape.points[1].y == 4);
+    REQUIRE(shape.points[2].x == -1); // the first of a repeated key wins
+    REQUIRE(shape.area == 6.5);
+    REQUIRE(shape.closed);
+    REQUIRE(shape.layer == 3);
+    REQUIRE(shape.tags.at("color") == "red");
+    REQUIRE(shape.extra.equals_deep(jsxxn::parse(R"([1, { "free": "form" }])")));
+  }
+
+  SECTION("Encodes the same tree as the DOM") {
+    binding_test::Shape shape = jsxxn::bind_parse<binding_test::Shape>(text);
+    std::string encoded = jsxxn::bind_stringify(shape);
+    REQUIRE(encoded.substr(0, 27) == R"({"name":"tri\"angle","point)");
+
+    jsxxn::JSON expected = jsxxn::parse(text);
+    std::get<jsxxn::JSONObject>(expected.value).erase("unknown");
+    expected["points"][2] = jsxxn::parse(R"({ "x": -1, "y": 0 })");
+    REQUIRE(jsxxn::parse(encoded).equals_deep(expected));
+
+    shape.area.reset();
+    REQUIRE(jsxxn::parse(jsxxn::bind_stringify(shape)).at("area").equals_deep(nullptr));
+  }
+
+  SECTION("Type mismatches throw") {
+    REQUIRE_THROWS_AS(jsxxn::bind_parse<binding_test::Point>(R"({ "x": "1" })"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::bind_parse<binding_test::Point>(R"({ "x": 1.5 })"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::bind_parse<binding_test::Shape>(R"({ "layer": 256 })"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::bind_parse<std::vector<std::int64_t>>("[1, 2] 3"), std::runtime_error);
+    REQUIRE(jsxxn::bind_parse<std::vector<std::int64_t>>("[1, 2e2]") == std::vector<std::int64_t>{ 1, 200 });
+  }
+
+  SECTION("Unsigned integers past INT64_MAX round trip") {
+    const std::vector<std::uint64_t> values{ 0, 9223372036854775808ULL, UINT64_MAX };
+    const std::string encoded = jsxxn::bind_stringify(values);
+    REQUIRE(encoded == "[0,9223372036854775808,18446744073709551615]");
+    REQUIRE(jsxxn::bind_parse<std::vector<std::uint64_t>>(encoded) == values);
+    REQUIRE(jsxxn::bind_parse<std::vector<std::uint64_t>>("[ /* c */ 18446744073709551615]")[0] == UINT64_MAX);
+
+    REQUIRE_THROWS_AS(jsxxn::bind_parse<std::uint64_t>("18446744073709551616"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::bind_parse<std::uint64_t>("-1"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::bind_parse<std::int64_t>("9223372036854775808"), std::runtime_error);
+  }
+}
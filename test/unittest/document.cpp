@@ -0,0 +1,284 @@
+#include "jsxxn.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+#include <filesystem>
+
+TEST_CASE("document") {
+
+  SECTION("Parsed tree lives in the document arena") {
+    jsxxn::Document doc(R"({ "key": "a string long enough to leave SSO", "arr": [1, 2, 3] })");
+    const jsxxn::JSONObject& obj = static_cast<const jsxxn::JSONObject&>(doc.root());
+    REQUIRE(obj.get_allocator().resource() == doc.resource());
+
+    const jsxxn::JSONArray& arr = static_cast<const jsxxn::JSONArray&>(doc.root().at("arr"));
+    REQUIRE(arr.get_allocator().resource() == doc.resource());
+    REQUIRE(arr.size() == 3);
+
+    const jsxxn::JSONString& str = static_cast<const jsxxn::JSONString&>(doc.root().at("key"));
+    REQUIRE(str.get_allocator().resource() == doc.resource());
+    REQUIRE(str == "a string long enough to leave SSO");
+  }
+
+  SECTION("Same tree as jsxxn::parse") {
+    const char* text = R"([ { "name": 3 }, { "age": 4.5 }, [ 3, 5, 8 ], "String", null, true ])";
+    jsxxn::Document doc(text);
+    REQUIRE(doc.root().equals_deep(jsxxn::parse(text)));
+  }
+
+  SECTION("Copies out of a document outlive it") {
+    jsxxn::JSON copy;
+    {
+      jsxxn::Document doc(R"({ "values": ["one", "two", "three"] })");
+      copy = doc.root().at("values");
+    }
+    REQUIRE(copy.size() == 3);
+    REQUIRE(copy.at(2).equals_deep("three"));
+  }
+
+  SECTION("Move assignment") {
+    jsxxn::Document doc("[1, 2, 3]");
+    doc = jsxxn::Document(R"({ "replaced": true })");
+    REQUIRE(doc.root().type() == jsxxn::JSONValueType::OBJECT);
+    REQUIRE(doc.root().at("replaced").equals_deep(true));
+  }
+
+  SECTION("Large objects keep their lookup index across copies and moves") {
+    std::string text = "{";
+    for (int i = 0; i < 40; i++)
+      text += (i > 0 ? ", \"k" : "\"k") + std::to_string(i) + "\": " + std::to_string(i);
+    text += "}";
+
+    jsxxn::JSON copy;
+    {
+      jsxxn::Document doc(text);
+      copy = doc.root();
+      jsxxn::JSON moved(std::move(copy));
+      copy = std::move(moved);
+    }
+    REQUIRE(copy.size() == 40);
+    for (int i = 0; i < 40; i++)
+      REQUIRE(copy.at("k" + std::to_string(i)).equals_deep(i));
+    REQUIRE_FALSE(copy.contains("k40"));
+  }
+}
+
+TEST_CASE("lazy document") {
+  const char* text = R"({
+    "header": { "id": 42, "route": "a/b" },
+    "body": [ { "skip": "}]\"[{" }, /* comment */ [1, [2, 3]], "x" ],
+    "escaped": true,
+    "header": "repeated"
+  })";
+
+  SECTION("Navigates to values") {
+    jsxxn::LazyDocument doc(text);
+    REQUIRE(doc.root().type() == jsxxn::JSONValueType::OBJECT);
+    REQUIRE(doc.at("header").at("id").parse().equals_deep(42));
+    REQUIRE(doc.at("header").at("route").raw() == R"("a/b")");
+    REQUIRE(doc.at("body").size() == 3);
+    REQUIRE(doc.at("body").at(1).at(1).raw() == "[2, 3]");
+    REQUIRE(doc.at("body").at(2).parse().equals_deep("x"));
+    REQUIRE(doc.at("escaped").type() == jsxxn::JSONValueType::BOOLEAN);
+    REQUIRE(doc.root().size() == 4);
+    REQUIRE_FALSE(doc.root().contains("missing"));
+    REQUIRE(doc.root().parse().equals_deep(jsxxn::parse(text)));
+  }
+
+  SECTION("Lookup errors") {
+    jsxxn::LazyDocument doc(text);
+    REQUIRE_THROWS_AS(doc.at("missing"), std::runtime_error);
+    REQUIRE_THROWS_AS(doc.at("body").at(3), std::out_of_range);
+    REQUIRE_THROWS_AS(doc.at("body").at("key"), std::runtime_error);
+    REQUIRE_THROWS_AS(doc.at(0), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::LazyDocument("  "), std::runtime_error);
+  }
+
+  SECTION("Malformed input is found only where it is walked") {
+    jsxxn::LazyDocument doc(R"({ "ok": 1, "bad": [1, 2,], "unclosed": [ )");
+    REQUIRE(doc.at("ok").parse().equals_deep(1));
+    REQUIRE_THROWS_AS(doc.at("bad").parse(), std::runtime_error);
+    REQUIRE_THROWS_AS(doc.at("unclosed").raw(), std::runtime_error);
+    REQUIRE_THROWS_AS(doc.at("after"), std::runtime_error);
+  }
+}
+
+TEST_CASE("tape", "[document]") {
+  jsxxn::JSON json = jsxxn::parse(R"({
+    "name": "catalog", "version": 3, "ratio": 0.25, "live": true, "retired": null,
+    "small": [ "a", { "b": [] }, 2 ],
+    "b": "key of a member, and a key inside of small"
+  })");
+  jsxxn::JSON big = jsxxn::JSONArray();
+  jsxxn::JSON wide = jsxxn::JSONObject();
+  for (int i = 0; i < 100; i++) {
+    big.push_back(jsxxn::parse(R"({ "id": )" + std::to_string(i) + R"(, "tags": ["x", "y"] })"));
+    wide["k" + std::to_string(99 - i)] = i;
+  }
+  json["big"] = std::move(big);
+  json["wide"] = std::move(wide);
+
+  const std::string data = jsxxn::to_tape(json);
+
+  SECTION("Reading values in place") {
+    jsxxn::TapeDocument doc(data);
+    REQUIRE(std::string_view(doc.at("name")) == "catalog");
+    REQUIRE(doc.at("version").xtype() == jsxxn::JSXXNValueType::SINTEGER);
+    REQUIRE(static_cast<std::int64_t>(doc.at("version")) == 3);
+    REQUIRE(static_cast<double>(doc.at("ratio")) == 0.25);
+    REQUIRE(static_cast<bool>(doc.at("live")));
+    REQUIRE(doc.at("retired").type() == jsxxn::JSONValueType::NULLPTR);
+    REQUIRE(doc.at("small").at(1).at("b").size() == 0);
+    REQUIRE(static_cast<std::int64_t>(doc.at("small").at(2)) == 2);
+
+    // large containers, which are looked up through their tables
+    REQUIRE(static_cast<std::int64_t>(doc.at("big").at(73).at("id")) == 73);
+    REQUIRE(std::string_view(doc.at("big").at(99).at("tags").at(1)) == "y");
+    REQUIRE(static_cast<std::int64_t>(doc.at("wide").at("k0")) == 99);
+    REQUIRE(static_cast<std::int64_t>(doc.at("wide").at("k57")) == 42);
+    REQUIRE_FALSE(doc.at("wide").contains("k100"));
+    REQUIRE_FALSE(doc.at("wide").contains(""));
+
+    REQUIRE_FALSE(doc.root().contains("missing"));
+    REQUIRE_THROWS_AS(doc.at("missing"), std::runtime_error);
+    REQUIRE_THROWS_AS(doc.at("big").at(100), std::out_of_range);
+    REQUIRE_THROWS_AS(doc.at("small").at(3), std::out_of_range);
+    REQUIRE_THROWS_AS(doc.at("name").at(0), std::runtime_error);
+    REQUIRE_THROWS_AS(static_cast<bool>(doc.at("name")), std::runtime_error);
+  }
+
+  #ifndef JSXXN_STD_MAP_OBJECT
+  SECTION("Iterating keeps the original order") {
+    jsxxn::TapeDocument doc(data);
+    int expected = 0;
+    for (jsxxn::TapeIterator it = doc.at("wide").begin(); it != doc.at("wide").end(); ++it) {
+      REQUIRE(it.key() == "k" + std::to_string(99 - expected));
+      REQUIRE(static_cast<std::int64_t>(it.value()) == expected++);
+    }
+    REQUIRE(expected == 100);
+
+    std::size_t count = 0;
+    for (jsxxn::TapeValue element : doc.at("small")) {
+      (void)element;
+      count++;
+    }
+    REQUIRE(count == 3);
+  }
+  #endif
+
+  SECTION("Copying out") {
+    REQUIRE(jsxxn::TapeDocument(data).root().to_json().equals_deep(json));
+    REQUIRE(jsxxn::TapeDocument(jsxxn::to_tape(jsxxn::JSON(1.5))).root().to_json().equals_deep(1.5));
+  }
+
+  SECTION("Bad tapes") {
+    REQUIRE_THROWS_AS(jsxxn::TapeDocument(""), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::TapeDocument(R"({ "not": "a tape", "but": "long enough to be one" })"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::TapeDocument(std::string_view(data).substr(0, data.size() - 1)), std::runtime_error);
+
+    // a root claiming more members than the tape has nodes
+    std::string corrupt = data;
+    for (std::size_t i = 40 + 4; i < 40 + 8; i++) corrupt[i] = '\xff';
+    jsxxn::TapeDocument doc(corrupt);
+    REQUIRE_THROWS_AS(doc.root().to_json(), std::runtime_error);
+  }
+
+  SECTION("Files") {
+    const std::string path = (std::filesystem::temp_directory_path() / "jsxxn_tape_test.tape").string();
+    {
+      std::FILE* file = std::fopen(path.c_str(), "wb");
+      REQUIRE(file != nullptr);
+      {
+        jsxxn::JSONWriter writer(file);
+        jsxxn::to_tape(json, writer);
+      }
+      std::fclose(file);
+    }
+
+    jsxxn::TapeDocument doc = jsxxn::TapeDocument::open(path);
+    jsxxn::TapeDocument moved(std::move(doc));
+    REQUIRE(moved.root().to_json().equals_deep(json));
+    std::filesystem::remove(path);
+  }
+}
+
+TEST_CASE("view document", "[document]") {
+  const std::string text = R"({ "name": "plain", "esc\"aped": "tab\there", "n": [1, -2.5, true, null, {}], "name": "again" })";
+  jsxxn::ViewDocument doc(text);
+  const jsxxn::ViewValue root = doc.root();
+
+  REQUIRE(root.type() == jsxxn::JSONValueType::OBJECT);
+  REQUIRE(root.size() == 4);
+  REQUIRE(root.to_json().equals_deep(jsxxn::parse(text)));
+
+  SECTION("Strings without escapes are views into the text") {
+    std::string_view name = static_cast<std::string_view>(root.at("name"));
+    REQUIRE(name == "plain");
+    REQUIRE(name.data() == text.data() + text.find("plain"));
+    REQUIRE(root.begin().key().data() == text.data() + text.find("name"));
+
+    // escaped strings and keys are decoded, but still found by their value
+    REQUIRE(static_cast<std::string_view>(root.at("esc\"aped")) == "tab\there");
+  }
+
+  SECTION("Reading values") {
+    REQUIRE(static_cast<std::string_view>(root.at("name")) == "plain"); // the first of repeated keys
+    REQUIRE(root.at("n").size() == 5);
+    REQUIRE(static_cast<std::int64_t>(doc.at("n").at(0)) == 1);
+    REQUIRE(static_cast<double>(root.at("n").at(1)) == -2.5);
+    REQUIRE(static_cast<bool>(root.at("n").at(2)));
+    REQUIRE(root.at("n").at(3).type() == jsxxn::JSONValueType::NULLPTR);
+    REQUIRE(root.at("n").at(4).size() == 0);
+    REQUIRE(root.contains("n"));
+    REQUIRE_FALSE(root.contains("missing"));
+    REQUIRE_THROWS_AS(root.at("n").at(5), std::out_of_range);
+    REQUIRE_THROWS_AS(root.at("missing"), std::runtime_error);
+    REQUIRE_THROWS_AS(static_cast<bool>(root.at("name")), std::runtime_error);
+
+    std::size_t elements = 0;
+    for (jsxxn::ViewValue element : root.at("n")) {
+      REQUIRE(element.to_json().equals_deep(jsxxn::parse(text).at("n").at(elements)));
+      elements++;
+    }
+    REQUIRE(elements == 5);
+  }
+
+  SECTION("Equal keys share one view") {
+    const jsxxn::ViewDocument rows(std::string_view(R"([{"id": 1, "tag": "a"}, {"id": 2, "tag": "b"}, {"t\u0061g": "c"}])"));
+    const jsxxn::ViewValue first = rows.at(std::size_t(0)), second = rows.at(1), third = rows.at(2);
+    REQUIRE(first.begin().key().data() == second.begin().key().data());
+    REQUIRE((++first.begin()).key() == "tag");
+    REQUIRE((++first.begin()).key().data() == (++second.begin()).key().data());
+    REQUIRE((++first.begin()).key().data() == third.begin().key().data()); // escaped or not
+
+    REQUIRE(static_cast<std::string_view>(third.at("tag")) == "c");
+    REQUIRE_FALSE(third.contains("id"));
+    REQUIRE_FALSE(third.contains("missing"));
+
+    // enough distinct keys to outgrow the first key table
+    std::string wide = "{";
+    for (int i = 0; i < 200; i++) wide += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+    wide += "}";
+    const jsxxn::ViewDocument many(std::move(wide));
+    for (int i = 0; i < 200; i++) REQUIRE(static_cast<std::int64_t>(many.at("k" + std::to_string(i))) == i);
+    REQUIRE_FALSE(many.root().contains("k200"));
+  }
+
+  SECTION("Owning the text") {
+    std::string copy = text;
+    jsxxn::ViewDocument owned(std::move(copy));
+    jsxxn::ViewDocument moved(std::move(owned));
+    REQUIRE(moved.root().to_json().equals_deep(jsxxn::parse(text)));
+    REQUIRE(static_cast<std::string_view>(jsxxn::ViewDocument(std::string("\"short\"")).root()) == "short");
+  }
+
+  SECTION("Malformed text throws like parse") {
+    for (const char* invalid : { "", "[", "[1,]", "{\"a\" 1}", "{1:2}", "01", "\"\\x\"", "[1] 2" }) {
+      REQUIRE_THROWS_AS(jsxxn::ViewDocument(std::string_view(invalid)), std::runtime_error);
+    }
+    REQUIRE_THROWS_AS(jsxxn::ViewDocument(std::string(300, '[') + std::string(300, ']')), std::runtime_error);
+  }
+}
@@ -58,4 +58,20 @@ TEST_CASE("dom") {
 
   }
 
-}
\ No newline at end of file
+  SECTION("Object lookups past the index threshold") {
+    jsxxn::JSON obj(jsxxn::JSONValueType::OBJECT);
+    for (int i = 0; i < 100; i++)
+      obj["key" + std::to_string(i)] = i;
+    REQUIRE(obj.size() == 100);
+    for (int i = 0; i < 100; i++)
+      REQUIRE(obj.at("key" + std::to_string(i)).equals_deep(i));
+    REQUIRE(obj.count("key100") == 0);
+  }
+
+  SECTION("Object emplace keeps the first value of a duplicate key") {
+    jsxxn::JSON obj = jsxxn::parse(R"({ "dup": 1, "dup": 2 })");
+    REQUIRE(obj.size() == 1);
+    REQUIRE(obj.at("dup").equals_deep(1));
+  }
+
+}
@@ -1,10 +1,423 @@
 #include "jsxxn.h"
+#include "jsxxn_impl.h"
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/stat.h>
+#endif
+
 TEST_CASE("trivial", "[parsing]") {
   SECTION("Number Parsing") {
     jsxxn::JSON num = jsxxn::parse("10");
     REQUIRE(num.type() == jsxxn::JSONValueType::NUMBER);
   }
-}
\ No newline at end of file
+
+  SECTION("Integer Limits") {
+    REQUIRE(static_cast<std::int64_t>(jsxxn::parse("9223372036854775807")) == INT64_MAX);
+    REQUIRE(static_cast<std::int64_t>(jsxxn::parse("-123456789012345678")) == -123456789012345678LL);
+    REQUIRE(jsxxn::parse("9223372036854775808").xtype() == jsxxn::JSXXNValueType::DOUBLE);
+    REQUIRE(jsxxn::parse("1e18").xtype() == jsxxn::JSXXNValueType::SINTEGER);
+  }
+
+  SECTION("Doubles are correctly rounded") {
+    REQUIRE(static_cast<double>(jsxxn::parse("0.1")) == 0.1);
+    REQUIRE(static_cast<double>(jsxxn::parse("-123.456e-2")) == -123.456e-2);
+    REQUIRE(static_cast<double>(jsxxn::parse("1.0e+28")) == 1.0e+28);
+    REQUIRE(static_cast<double>(jsxxn::parse("2.2250738585072014e-308")) == 2.2250738585072014e-308);
+    REQUIRE_THROWS(jsxxn::parse("1e309"));
+  }
+
+  SECTION("String Parsing") {
+    jsxxn::JSON plain = jsxxn::parse(R"("no escapes here")");
+    REQUIRE(plain.equals_deep("no escapes here"));
+
+    jsxxn::JSON escaped = jsxxn::parse(R"("tab\there \"quoted\" \u00e9 end")");
+    REQUIRE(escaped.equals_deep("tab\there \"quoted\" \xC3\xA9 end"));
+
+    jsxxn::JSON key = jsxxn::parse(R"({ "esc\naped": 1, "plain": 2 })");
+    REQUIRE(key.contains("esc\naped"));
+    REQUIRE(key.contains("plain"));
+  }
+}
+
+TEST_CASE("object keys", "[parsing]") {
+  SECTION("Duplicate keys keep the first member") {
+    jsxxn::JSON obj = jsxxn::parse(R"({ "a": 1, "b": 2, "a": 3 })");
+    REQUIRE(obj.size() == 2);
+    REQUIRE(obj.at("a").equals_deep(1));
+
+    // the same key, once escaped and once not
+    REQUIRE(jsxxn::parse(R"({ "\u0061": 1, "a": 2 })").size() == 1);
+    REQUIRE(jsxxn::parse(R"({ "a": 1, "\u0061": 2 })").at("a").equals_deep(1));
+
+    // same key in a nested object in between
+    REQUIRE(jsxxn::parse(R"({ "a": 1, "b": { "a": 2 }, "a": 3 })").size() == 2);
+  }
+
+  SECTION("Records of changing shape") {
+    std::string text = "[";
+    for (int i = 0; i < 100; i++) {
+      if (i > 0) text += ", ";
+      text += "{";
+      for (int k = 0; k < (i * 7) % 90; k++)
+        text += (k > 0 ? ", \"k" : "\"k") + std::to_string((k * 3 + i) % 90) + "\": " + std::to_string(k);
+      text += "}";
+    }
+    text += "]";
+
+    jsxxn::JSON arr = jsxxn::parse(text);
+    REQUIRE(arr.size() == 100);
+    // keys repeat every 30 members, and the first of each is kept
+    for (int i = 0; i < 100; i++) {
+      const int distinct = std::min((i * 7) % 90, 30);
+      REQUIRE(arr.at(i).size() == static_cast<std::size_t>(distinct));
+      for (int k = 0; k < distinct; k++)
+        REQUIRE(arr.at(i).at("k" + std::to_string((k * 3 + i) % 90)).equals_deep(k));
+    }
+  }
+
+  SECTION("Shared shape cache") {
+    jsxxn::JSONShapeCache shapes;
+    const char* records[] = {
+      R"({ "id": 1, "name": "one", "tags": { "x": 1 } })",
+      R"({ "id": 2, "name": "two", "tags": { "x": 2, "y": 3 } })",
+      R"({ "name": "three", "id": 3, "id": 4 })",
+    };
+    for (const char* record : records)
+      REQUIRE(jsxxn::parse(record, std::pmr::get_default_resource(), shapes).equals_deep(jsxxn::parse(record)));
+    REQUIRE(shapes.size() == 5);
+
+    // the cache keeps its keys after the text they came from is gone
+    {
+      std::string record = R"({ "a long key which doesn't fit inline": 1 })";
+      jsxxn::parse(record, std::pmr::get_default_resource(), shapes);
+      std::fill(record.begin(), record.end(), ' ');
+    }
+    jsxxn::JSON json = jsxxn::parse(R"({ "a long key which doesn't fit inline": 2, "id": 5 })", std::pmr::get_default_resource(), shapes);
+    REQUIRE(shapes.size() == 6);
+    REQUIRE(static_cast<std::int64_t>(json.at("a long key which doesn't fit inline")) == 2);
+
+    shapes.clear();
+    REQUIRE(shapes.size() == 0);
+    REQUIRE(jsxxn::parse(records[0], std::pmr::get_default_resource(), shapes).equals_deep(jsxxn::parse(records[0])));
+  }
+}
+
+TEST_CASE("ndjson", "[parsing]") {
+  std::string lines;
+  for (int i = 0; i < 1000; i++)
+    lines += (i == 500 ? std::string("{\"bad\": }") : "{\"id\": " + std::to_string(i) + "}") + "\n";
+  lines += "\n   \n[\"last\"]";
+
+  for (unsigned int threads : { 1U, 4U }) {
+    std::vector<jsxxn::NDJSONRecord> records = jsxxn::parse_ndjson(lines, threads);
+    REQUIRE(records.size() == 1001);
+
+    for (int i = 0; i < 1000; i++) {
+      REQUIRE(records[i].line == static_cast<std::size_t>(i + 1));
+      if (i == 500) {
+        REQUIRE_FALSE(records[i].ok());
+        continue;
+      }
+      REQUIRE(records[i].ok());
+      REQUIRE(static_cast<std::int64_t>(records[i].value.at("id")) == i);
+    }
+
+    REQUIRE(records[1000].line == 1003);
+    REQUIRE(records[1000].value.equals_deep(jsxxn::parse("[\"last\"]")));
+  }
+}
+
+TEST_CASE("parse_file", "[parsing]") {
+  const std::string path = (std::filesystem::temp_directory_path() / "jsxxn_parse_file_test.json").string();
+  const std::string text = R"({ "name": "jsxxn", "list": [1, 2.5, null] })";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << text;
+  }
+
+  REQUIRE(jsxxn::parse_file(path).equals_deep(jsxxn::parse(text)));
+
+  jsxxn::MappedFile file(path);
+  REQUIRE(file.view() == text);
+  jsxxn::MappedFile moved(std::move(file));
+  REQUIRE(moved.view() == text);
+  REQUIRE(file.view().empty());
+
+  std::filesystem::remove(path);
+  REQUIRE_THROWS(jsxxn::parse_file(path));
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("parse_file from a pipe", "[parsing]") {
+  const std::string path = (std::filesystem::temp_directory_path() / "jsxxn_parse_file_test.fifo").string();
+  std::filesystem::remove(path);
+  REQUIRE(::mkfifo(path.c_str(), 0600) == 0);
+
+  // larger than the first read buffer, so that it has to grow
+  std::string text = "[";
+  for (int i = 0; i < 20000; i++) text += "\"element\", ";
+  text += "0]";
+
+  std::thread writer([&path, &text]() {
+    std::ofstream out(path, std::ios::binary);
+    out << text;
+  });
+  jsxxn::JSON json = jsxxn::parse_file(path);
+  writer.join();
+  std::filesystem::remove(path);
+
+  REQUIRE(json.size() == 20001);
+}
+#endif
+
+TEST_CASE("parse_parallel", "[parsing]") {
+  // big enough to actually be split up
+  std::string big = "[";
+  for (int i = 0; i < 20000; i++) {
+    if (i != 0) big += ",";
+    big += R"({"id": )" + std::to_string(i) + R"(, "text": "commas, [brackets] and \"quotes\"", "list": [1, [2, {"x": 3}]]})";
+  }
+  big += "]";
+
+  SECTION("Same result as parse") {
+    for (unsigned int threads : { 1U, 2U, 7U })
+      REQUIRE(jsxxn::parse_parallel(big, threads).equals_deep(jsxxn::parse(big)));
+  }
+
+  SECTION("Same errors as parse") {
+    std::string bad = big;
+    bad.replace(bad.size() / 2, 1, "}");
+    std::string expected;
+    try { jsxxn::parse(bad); } catch (const std::runtime_error& e) { expected = e.what(); }
+    REQUIRE_FALSE(expected.empty());
+
+    std::string got;
+    try { jsxxn::parse_parallel(bad, 4); } catch (const std::runtime_error& e) { got = e.what(); }
+    REQUIRE(got == expected);
+  }
+}
+
+
+TEST_CASE("JSON Pointer extract", "[parsing]") {
+  const char* text = R"({
+    "header": { "id": 42, "a/b": "slash", "m~n": "tilde" },
+    "items": [ { "name": "zero" }, { "name": "one", "skip": "]}\"" } ],
+    "": "empty key",
+    "header": "repeated"
+  })";
+
+  SECTION("Single pointers") {
+    REQUIRE(jsxxn::extract(text, "/header/id").equals_deep(42));
+    REQUIRE(jsxxn::extract(text, "/header/a~1b").equals_deep("slash"));
+    REQUIRE(jsxxn::extract(text, "/header/m~0n").equals_deep("tilde"));
+    REQUIRE(jsxxn::extract(text, "/items/1/name").equals_deep("one"));
+    REQUIRE(jsxxn::extract(text, "/").equals_deep("empty key"));
+    REQUIRE(jsxxn::extract(text, "/items/0").equals_deep(jsxxn::parse(R"({ "name": "zero" })")));
+    REQUIRE(jsxxn::extract(text, "").equals_deep(jsxxn::parse(text)));
+
+    REQUIRE_THROWS_AS(jsxxn::extract(text, "/items/2"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::extract(text, "/items/01"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::extract(text, "/items/-"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::extract(text, "/header/id/deeper"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::extract(text, "header"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::extract(text, "/header/~2"), std::runtime_error);
+  }
+
+  SECTION("Batches") {
+    std::vector<std::optional<jsxxn::JSON>> found = jsxxn::extract(text,
+      { "/items/1/name", "/missing", "/header", "/header/id", "/items/0/name" });
+    REQUIRE(found.size() == 5);
+    REQUIRE(found[0]->equals_deep("one"));
+    REQUIRE_FALSE(found[1].has_value());
+    REQUIRE(found[2]->at("id").equals_deep(42));
+    REQUIRE(found[3]->equals_deep(42));
+    REQUIRE(found[4]->equals_deep("zero"));
+  }
+
+  SECTION("Stops once everything is found") {
+    // the broken tail is never reached
+    REQUIRE(jsxxn::extract(R"({ "a": { "b": 1 }, "c": [ )", "/a/b").equals_deep(1));
+    REQUIRE_THROWS_AS(jsxxn::extract(R"({ "a": { "b": 1 }, "c": [ )", "/c/0"), std::runtime_error);
+  }
+}
+
+TEST_CASE("validate", "[parsing]") {
+  for (const char* valid : { "{}", "[]", "0", "\"\"", R"({ "a": [1, -2.5e3, true, false, null, "\u00e9\n"], "b": {} })", " [1] // comment\n" }) {
+    jsxxn::JSONValidation result = jsxxn::validate(valid);
+    REQUIRE(result);
+    REQUIRE_FALSE(result.error);
+  }
+
+  for (const char* invalid : { "", "[", "[1,]", "{\"a\" 1}", "01", "\"\\x\"", "\"\x01\"", "tru", "{} {}", "[1] 2" }) {
+    jsxxn::JSONValidation result = jsxxn::validate(invalid);
+    REQUIRE_FALSE(result);
+    REQUIRE(result.error);
+  }
+
+  SECTION("Errors match parse and point at the offending token") {
+    const std::string text = "{\n  \"a\": [1, 2],\n  \"b\": 012\n}";
+    jsxxn::JSONValidation result = jsxxn::validate(text);
+    REQUIRE_FALSE(result);
+    REQUIRE(result.error.code == jsxxn::ParseErrorCode::NUMBER_LEADING_ZEROS);
+    REQUIRE(result.error.offset == text.find("012"));
+    REQUIRE(result.error.line == 3);
+    REQUIRE(result.error.column == 8);
+
+    std::string parse_error;
+    try {
+      jsxxn::parse(text);
+    } catch (const std::runtime_error& e) {
+      parse_error = e.what();
+    }
+    REQUIRE(result.error.message() == parse_error);
+  }
+
+  SECTION("Agrees with parse on what follows the value") {
+    for (const char* text : { "[1] 2", "1 2", "{} {}", "\"a\" \"b\"", "[1] // comment", "[1] /* a */ ", "null ]", "1 ," }) {
+      bool parsed = true;
+      try {
+        jsxxn::parse(text);
+      } catch (const std::runtime_error&) {
+        parsed = false;
+      }
+      REQUIRE(static_cast<bool>(jsxxn::validate(text)) == parsed);
+    }
+  }
+
+  SECTION("Nesting limit") {
+    REQUIRE(jsxxn::validate(std::string(200, '[') + std::string(200, ']')));
+    REQUIRE_FALSE(jsxxn::validate(std::string(300, '[') + std::string(300, ']')));
+  }
+}
+
+TEST_CASE("parse with ParseError", "[parsing]") {
+  jsxxn::ParseError error;
+  jsxxn::JSON json = jsxxn::parse(R"({ "a": [1, 2.5, "b"] })", error);
+  REQUIRE_FALSE(error);
+  REQUIRE(error.code == jsxxn::ParseErrorCode::NONE);
+  REQUIRE(json["a"].size() == 3);
+
+  SECTION("Codes and positions") {
+    using jsxxn::ParseErrorCode;
+    struct Case { std::string text; ParseErrorCode code; std::size_t offset; };
+    const std::vector<Case> cases = {
+      // lexer errors point at the malformed text
+      { "@", ParseErrorCode::UNEXPECTED_CHARACTER, 0 },
+      { "[tru]", ParseErrorCode::INVALID_KEYWORD, 1 },
+      { "[1] /x", ParseErrorCode::INVALID_COMMENT, 4 },
+      { "[1e999]", ParseErrorCode::NUMBER_TOO_LARGE, 1 },
+      { "[-]", ParseErrorCode::NUMBER_NO_INTEGER_PART, 1 },
+      { ".5", ParseErrorCode::NUMBER_LEADING_DECIMAL, 0 },
+      { "1.", ParseErrorCode::NUMBER_TRAILING_DECIMAL, 0 },
+      { "[0, 00]", ParseErrorCode::NUMBER_LEADING_ZEROS, 4 },
+      { "1ex", ParseErrorCode::NUMBER_INVALID_EXPONENT, 0 },
+      { "\"abc", ParseErrorCode::STRING_UNCLOSED, 1 },
+      { "\"\x01\"", ParseErrorCode::STRING_CONTROL_CHARACTER, 1 },
+      { "\"\\x\"", ParseErrorCode::STRING_INVALID_ESCAPE, 1 },
+      { "\"\\", ParseErrorCode::STRING_UNESCAPED_BACKSLASH, 1 },
+      { "\"\\u12\"", ParseErrorCode::STRING_INCOMPLETE_HEX, 1 },
+      { "\"\\u12g4\"", ParseErrorCode::STRING_INVALID_HEX, 1 },
+
+      // grammar errors point at the offending token
+      { "[,]", ParseErrorCode::EXPECTED_VALUE, 1 },
+      { "{1:2}", ParseErrorCode::EXPECTED_KEY, 1 },
+      { "{\"a\" 1}", ParseErrorCode::EXPECTED_COLON, 5 },
+      { "[1 2]", ParseErrorCode::UNEXPECTED_ARRAY_TOKEN, 3 },
+      { "{\"a\":1 \"b\"}", ParseErrorCode::UNEXPECTED_OBJECT_TOKEN, 7 },
+      { std::string(300, '[') + std::string(300, ']'), ParseErrorCode::MAX_NESTING_DEPTH, 251 },
+
+      // anything after the value points at the first extra token
+      { "{} {}", ParseErrorCode::TRAILING_TOKENS, 3 },
+      { "[1] 2", ParseErrorCode::TRAILING_TOKENS, 4 },
+      { "1 /* c */ 2", ParseErrorCode::TRAILING_TOKENS, 10 },
+
+      // lexer errors past whitespace and comments
+      { "[1, /* c */ 01]", ParseErrorCode::NUMBER_LEADING_ZEROS, 12 },
+      { "// c\n@", ParseErrorCode::UNEXPECTED_CHARACTER, 5 },
+
+      // errors at the end of the input point at its end
+      { "", ParseErrorCode::UNEXPECTED_EOF, 0 },
+      { "[1,  ", ParseErrorCode::UNEXPECTED_EOF, 5 },
+      { "[1", ParseErrorCode::UNCLOSED_ARRAY, 2 },
+      { "{\"a\":1 // c", ParseErrorCode::UNCLOSED_OBJECT, 11 },
+    };
+
+    for (const Case& c : cases) {
+      json = jsxxn::parse(c.text, error);
+      REQUIRE(error);
+      REQUIRE(json.type() == jsxxn::JSONValueType::NULLPTR);
+      REQUIRE(error.code == c.code);
+      REQUIRE(error.offset == c.offset);
+
+      // validate follows the same grammar, so it stops at the same place
+      jsxxn::JSONValidation result = jsxxn::validate(c.text);
+      REQUIRE_FALSE(result);
+      REQUIRE(result.error.code == c.code);
+      REQUIRE(result.error.offset == c.offset);
+      REQUIRE(result.error.message() == error.message());
+    }
+
+    jsxxn::parse("[1,\n\n", error);
+    REQUIRE(error.code == ParseErrorCode::UNEXPECTED_EOF);
+    REQUIRE(error.line == 3);
+    REQUIRE(error.column == 1);
+  }
+
+  SECTION("Messages match the ones parse throws") {
+    for (const char* invalid : { "", "[", "[1,]", "{\"a\" 1}", "{1:2}", "01", "1e", "\"\\x\"", "\"\x01\"", "tru", "1 2 3" }) {
+      std::string thrown;
+      try {
+        jsxxn::parse(invalid);
+      } catch (const std::runtime_error& e) {
+        thrown = e.what();
+      }
+
+      jsxxn::parse(invalid, error);
+      REQUIRE(error);
+      REQUIRE(error.message() == thrown);
+    }
+  }
+}
+
+TEST_CASE("tokenize", "[parsing]") {
+  using jsxxn::TokenType;
+  const jsxxn::TokenTape tape = jsxxn::tokenize("[1, /* c */ \"a\\\"b\", -2.5e1 // x\n, {\"k\": 30}]");
+
+  REQUIRE(tape.types == std::vector<TokenType>{
+    TokenType::LEFT_BRACKET, TokenType::NUMBER, TokenType::COMMA, TokenType::STRING,
+    TokenType::COMMA, TokenType::NUMBER, TokenType::COMMA, TokenType::LEFT_BRACE,
+    TokenType::STRING, TokenType::COLON, TokenType::NUMBER, TokenType::RIGHT_BRACE,
+    TokenType::RIGHT_BRACKET, TokenType::END_OF_FILE
+  });
+  // offsets point past whitespace and comments, the end of file at the size
+  REQUIRE(tape.offsets == std::vector<std::size_t>{ 0, 1, 2, 12, 18, 20, 32, 34, 35, 38, 40, 42, 43, 44 });
+  REQUIRE(tape.size() == 14);
+
+  REQUIRE(tape.strings == std::vector<std::string_view>{ "a\\\"b", "k" });
+  REQUIRE(tape.escaped == std::vector<bool>{ true, false });
+  REQUIRE(tape.numbers == std::vector<jsxxn::JSONNumber>{
+    jsxxn::JSONNumber(std::int64_t(1)), jsxxn::JSONNumber(-25.0), jsxxn::JSONNumber(std::int64_t(30))
+  });
+
+  SECTION("Empty input is just the end of file") {
+    const jsxxn::TokenTape empty = jsxxn::tokenize("  // nothing\n");
+    REQUIRE(empty.types == std::vector<TokenType>{ TokenType::END_OF_FILE });
+    REQUIRE(empty.offsets == std::vector<std::size_t>{ 13 });
+  }
+
+  SECTION("Malformed tokens throw") {
+    REQUIRE_THROWS_AS(jsxxn::tokenize("[1, 01]"), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::tokenize("[1] / 2"), std::runtime_error);
+  }
+}
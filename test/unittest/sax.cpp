@@ -0,0 +1,150 @@
+#include "jsxxn.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+namespace {
+
+  // writes every event out as a single character or a short tag
+  class RecordingHandler : public jsxxn::JSONHandler {
+    public:
+      std::string events;
+
+      void on_null() override { events += "n "; }
+      void on_bool(bool value) override { events += value ? "t " : "f "; }
+      void on_number(jsxxn::JSONNumber value) override {
+        events += "#" + jsxxn::json_number_serialize(value) + " ";
+      }
+      void on_string(std::string_view value) override { events += "s:" + std::string(value) + " "; }
+      void on_key(std::string_view key) override { events += "k:" + std::string(key) + " "; }
+      void on_start_object() override { events += "{ "; }
+      void on_end_object() override { events += "} "; }
+      void on_start_array() override { events += "[ "; }
+      void on_end_array() override { events += "] "; }
+  };
+
+  std::string parse_error(std::string_view str) {
+    try {
+      jsxxn::parse(str);
+    } catch (const std::runtime_error& e) {
+      return e.what();
+    }
+    return "";
+  }
+
+  std::string sax_error(std::string_view str) {
+    jsxxn::JSONHandler ignore;
+    try {
+      jsxxn::parse(str, ignore);
+    } catch (const std::runtime_error& e) {
+      return e.what();
+    }
+    return "";
+  }
+
+}
+
+TEST_CASE("sax", "[parsing]") {
+  SECTION("Events arrive in document order") {
+    RecordingHandler handler;
+    jsxxn::parse(R"({ "a": [1, 2.5, "x\ty"], "b": { "c": null, "d": true }, "e": [] })", handler);
+    REQUIRE(handler.events == "{ k:a [ #1 #2.5 s:x\ty ] k:b { k:c n k:d t } k:e [ ] } ");
+  }
+
+  SECTION("Top level literals") {
+    RecordingHandler handler;
+    jsxxn::parse("false", handler);
+    REQUIRE(handler.events == "f ");
+  }
+
+  SECTION("Errors match parse") {
+    for (std::string_view bad : { "[1, 2", "{ \"a\" 1 }", "{ 1: 2 }", "[1 2]", "", "{ \"a\": }", "[1] 2", "1 2", "{} {}" }) {
+      std::string expected = parse_error(bad);
+      REQUIRE_FALSE(expected.empty());
+      REQUIRE(sax_error(bad) == expected);
+    }
+  }
+}
+
+TEST_CASE("push parser", "[parsing]") {
+  const std::string_view text = R"({ "key \"esc\"": [1, -2.5e+3, true, null], "uni": "é😀", /* c */ "n": 12345678901 })";
+  const jsxxn::JSON expected = jsxxn::parse(text);
+
+  SECTION("Chunks can be split anywhere") {
+    for (std::size_t split = 0; split <= text.size(); split++) {
+      std::vector<jsxxn::JSON> values;
+      jsxxn::JSONBuilder builder([&values](jsxxn::JSON&& value) { values.push_back(std::move(value)); });
+      jsxxn::PushParser parser(builder);
+      parser.feed(text.substr(0, split));
+      parser.feed(text.substr(split));
+      parser.finish();
+      REQUIRE(values.size() == 1);
+      REQUIRE(values[0].equals_deep(expected));
+    }
+  }
+
+  SECTION("One byte at a time") {
+    RecordingHandler whole, bytes;
+    jsxxn::parse(text, whole);
+    jsxxn::PushParser parser(bytes);
+    for (char ch : text) parser.feed(std::string_view(&ch, 1));
+    parser.finish();
+    REQUIRE(bytes.events == whole.events);
+  }
+
+  SECTION("Long tokens and comments in small chunks") {
+    std::string long_text = "[\"";
+    for (int i = 0; i < 20000; i++) long_text += i % 100 == 0 ? "\\\"" : "ab";
+    long_text += "\", // line comment\n /* block **/ 1";
+    long_text += std::string(300, '0');
+    long_text += ".5, tru";
+    long_text += "e]";
+
+    RecordingHandler whole;
+    jsxxn::parse(long_text, whole);
+    // small chunks, and chunks which finish an unfinished token and go on
+    for (std::size_t size : { 7, 100, 5000 }) {
+      RecordingHandler chunks;
+      jsxxn::PushParser parser(chunks);
+      for (std::size_t i = 0; i < long_text.size(); i += size)
+        parser.feed(std::string_view(long_text).substr(i, size));
+      parser.finish();
+      REQUIRE(chunks.events == whole.events);
+    }
+  }
+
+  SECTION("Multiple values") {
+    std::vector<jsxxn::JSON> values;
+    jsxxn::JSONBuilder builder([&values](jsxxn::JSON&& value) { values.push_back(std::move(value)); });
+    jsxxn::PushParser parser(builder, true);
+    parser.feed("{\"a\": 1}\n[2, 3]\n4");
+    REQUIRE(values.size() == 2); // 4 could still be 45
+    parser.feed("5\n\"six\"");
+    parser.finish();
+    REQUIRE(values.size() == 4);
+    REQUIRE(static_cast<std::int64_t>(values[2]) == 45);
+  }
+
+  SECTION("Errors") {
+    jsxxn::JSONHandler ignore;
+    jsxxn::PushParser unclosed(ignore);
+    unclosed.feed("[1, 2");
+    REQUIRE_THROWS_AS(unclosed.finish(), std::runtime_error);
+
+    jsxxn::PushParser extra(ignore);
+    extra.feed("1 2");
+    REQUIRE_THROWS_AS(extra.finish(), std::runtime_error);
+
+    // the push parser and parse(str, handler) reject the same trailing input
+    for (std::string_view trailing : { "[1] 2", "{} {}", "\"a\" // c\n 1" }) {
+      REQUIRE_FALSE(sax_error(trailing).empty());
+      jsxxn::PushParser parser(ignore);
+      REQUIRE_THROWS_AS((parser.feed(trailing), parser.finish()), std::runtime_error);
+    }
+  }
+}
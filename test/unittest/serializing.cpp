@@ -2,9 +2,152 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <string>
+#include <sstream>
+#include <stdexcept>
+
 TEST_CASE("serializing") {
   
   SECTION("trivial") {
     REQUIRE(jsxxn::prettify(jsxxn::parse("{}")) == jsxxn::prettify(jsxxn::JSONObject()));
   }
-}
\ No newline at end of file
+
+  #ifndef JSXXN_STD_MAP_OBJECT
+  SECTION("Objects keep insertion order") {
+    REQUIRE(jsxxn::stringify(jsxxn::parse(R"({ "b": 1, "a": 2, "c": 3 })")) == R"({"b":1,"a":2,"c":3})");
+  }
+  #endif
+
+  SECTION("String escapes") {
+    // long enough to cross several vector blocks in the escape scanner
+    std::string raw = std::string(40, 'a') + "\"" + std::string(17, 'b') + "\\\n\x01\x7F" + "caf\xC3\xA9" + std::string(33, 'c') + "\t";
+    std::string expected = "\"" + std::string(40, 'a') + "\\\"" + std::string(17, 'b') + "\\\\\\n\\u0001\\u007F" + "caf\xC3\xA9" + std::string(33, 'c') + "\\t\"";
+    REQUIRE(jsxxn::stringify(jsxxn::JSON(raw)) == expected);
+    REQUIRE(jsxxn::parse(expected).equals_deep(jsxxn::JSON(raw)));
+  }
+
+  SECTION("Doubles round trip") {
+    for (double num : { 0.1, 1.0 / 3.0, -2.5e-7, 1e+28, 5e-324, 1.7976931348623157e308, 100.0, -0.0 }) {
+      jsxxn::JSON reparsed = jsxxn::parse(jsxxn::stringify(jsxxn::JSON(num)));
+      REQUIRE(reparsed.xtype() == jsxxn::JSXXNValueType::DOUBLE);
+      REQUIRE(std::get<double>(std::get<jsxxn::JSONNumber>(std::get<jsxxn::JSONLiteral>(reparsed.value))) == num);
+    }
+
+    REQUIRE(jsxxn::stringify(jsxxn::JSON(0.1)) == "0.1");
+    REQUIRE(jsxxn::stringify(jsxxn::JSON(100.0)) == "100.0");
+  }
+}
+
+TEST_CASE("writer", "[serializing]") {
+  jsxxn::JSON json = jsxxn::parse(R"({ "list": [1, 2.5, "three", { "four": null }], "empty": [], "obj": {} })");
+
+  SECTION("Matches the string serializers") {
+    // a tiny buffer so that output is flushed many times over
+    std::string out;
+    {
+      jsxxn::JSONWriter writer([&out](const char* data, std::size_t size) { out.append(data, size); }, 3);
+      jsxxn::stringify(json, writer);
+    }
+    REQUIRE(out == jsxxn::stringify(json));
+
+    std::ostringstream stream;
+    jsxxn::JSONWriter writer(stream);
+    jsxxn::prettify(json, writer);
+    writer.flush();
+    REQUIRE(stream.str() == jsxxn::prettify(json));
+  }
+
+  SECTION("Sink errors are thrown") {
+    jsxxn::JSONWriter writer([](const char*, std::size_t) { throw std::runtime_error("full"); }, 4);
+    REQUIRE_THROWS(jsxxn::stringify(json, writer));
+  }
+}
+
+TEST_CASE("presized serialization", "[serializing]") {
+  jsxxn::JSON json = jsxxn::parse(R"({ "text": "esc\"aped\n\u0001", "nums": [0, -12, 2.5e-8, 1e300], "deep": [[{}], {"a": [true, false, null]}] })");
+
+  const std::string str = jsxxn::stringify(json);
+  REQUIRE(jsxxn::stringify_size(json) == str.size());
+  std::string presized(jsxxn::stringify_size(json), '\0');
+  REQUIRE(jsxxn::stringify(json, presized.data()) == presized.data() + presized.size());
+  REQUIRE(presized == str);
+
+  const std::string pretty = jsxxn::prettify(json);
+  REQUIRE(jsxxn::prettify_size(json) == pretty.size());
+  std::string pretty_presized(jsxxn::prettify_size(json), '\0');
+  REQUIRE(jsxxn::prettify(json, pretty_presized.data()) == pretty_presized.data() + pretty_presized.size());
+  REQUIRE(pretty_presized == pretty);
+}
+
+TEST_CASE("parallel stringify", "[serializing]") {
+  jsxxn::JSON records = jsxxn::JSONArray();
+  for (int i = 0; i < 1000; i++) {
+    jsxxn::JSON record = jsxxn::JSONObject();
+    record["id"] = i;
+    record["name"] = jsxxn::JSON("record " + std::to_string(i));
+    record["tags"] = jsxxn::JSONArray({ jsxxn::JSON("a"), jsxxn::JSON(i * 0.5) });
+    records.push_back(std::move(record));
+  }
+  jsxxn::JSON json = jsxxn::JSONObject();
+  json["records"] = records;
+  json["small"] = jsxxn::JSONArray({ jsxxn::JSON(1), jsxxn::JSON(2) });
+
+  const std::string expected = jsxxn::stringify(json);
+  for (unsigned int threads : { 1U, 3U, 8U })
+    for (std::size_t min_parallel_size : { 0UL, 2UL, 7UL, 5000UL })
+      REQUIRE(jsxxn::stringify_parallel(json, threads, min_parallel_size) == expected);
+}
+
+
+TEST_CASE("MessagePack", "[serializing]") {
+  SECTION("Round trips keep integers and doubles apart") {
+    jsxxn::JSON json = jsxxn::parse(R"({
+      "ints": [0, 127, 128, 255, 256, 65535, 65536, 4294967295, 4294967296, 9223372036854775807,
+        -1, -32, -33, -128, -129, -32768, -32769, -2147483648, -2147483649, -9223372036854775808],
+      "doubles": [0.0, -0.0, 1.5, 1e300, 3.0],
+      "strings": ["", "short", "café", "a\u0000b"],
+      "nested": { "empty_object": {}, "empty_array": [], "literals": [true, false, null] }
+    })");
+    jsxxn::JSONArray& big = static_cast<jsxxn::JSONArray&>(json["nested"]["big"] = jsxxn::JSONArray());
+    for (int i = 0; i < 70000; i++) big.push_back(jsxxn::JSON(i));
+    json["long_string"] = jsxxn::JSON(std::string(70000, 'x'));
+
+    const std::string packed = jsxxn::to_msgpack(json);
+    jsxxn::JSON unpacked = jsxxn::parse_msgpack(packed);
+    REQUIRE(unpacked.equals_deep(json));
+    REQUIRE(jsxxn::stringify(unpacked) == jsxxn::stringify(json));
+    REQUIRE(unpacked["doubles"][4].xtype() == jsxxn::JSXXNValueType::DOUBLE);
+    REQUIRE(unpacked["ints"][9].xtype() == jsxxn::JSXXNValueType::SINTEGER);
+
+    std::string streamed;
+    {
+      jsxxn::JSONWriter writer([&streamed](const char* data, std::size_t size) { streamed.append(data, size); }, 16);
+      jsxxn::to_msgpack(json, writer);
+    }
+    REQUIRE(streamed == packed);
+  }
+
+  SECTION("Encodings") {
+    REQUIRE(jsxxn::to_msgpack(jsxxn::parse("[1, -1, null, true]")) == "\x94\x01\xff\xc0\xc3");
+    REQUIRE(jsxxn::to_msgpack(jsxxn::parse(R"({"a": "b"})")) == "\x81\xa1" "a" "\xa1" "b");
+    REQUIRE(jsxxn::to_msgpack(jsxxn::JSON(300)) == std::string("\xcd\x01\x2c", 3));
+    REQUIRE(jsxxn::to_msgpack(jsxxn::JSON(1.0)) == std::string("\xcb\x3f\xf0\0\0\0\0\0\0", 9));
+  }
+
+  SECTION("Decoding other encoders' output") {
+    REQUIRE(jsxxn::parse_msgpack(std::string("\xca\x3f\xc0\0\0", 5)).equals_deep(1.5));
+    REQUIRE(jsxxn::parse_msgpack(std::string("\xd0\x80", 2)).equals_deep(-128));
+    REQUIRE(jsxxn::parse_msgpack("\xcf\xff\xff\xff\xff\xff\xff\xff\xff").xtype() == jsxxn::JSXXNValueType::DOUBLE);
+    REQUIRE(jsxxn::parse_msgpack("\x82\xa1" "a" "\x01\xa1" "a" "\x02").equals_deep(jsxxn::parse(R"({"a": 1})")));
+  }
+
+  SECTION("Malformed input") {
+    REQUIRE_THROWS_AS(jsxxn::parse_msgpack(""), std::runtime_error);
+    REQUIRE_THROWS_AS(jsxxn::parse_msgpack("\x92\x01"), std::runtime_error); // truncated
+    REQUIRE_THROWS_AS(jsxxn::parse_msgpack("\xdd\xff\xff\xff\xff"), std::runtime_error); // size past the end
+    REQUIRE_THROWS_AS(jsxxn::parse_msgpack("\x81\x01\x02"), std::runtime_error); // integer key
+    REQUIRE_THROWS_AS(jsxxn::parse_msgpack("\xc4\x01" "a"), std::runtime_error); // bin
+    REQUIRE_THROWS_AS(jsxxn::parse_msgpack("\x01\x02"), std::runtime_error); // trailing bytes
+    REQUIRE_THROWS_AS(jsxxn::parse_msgpack(std::string(300, '\x91') + "\x01"), std::runtime_error); // too deep
+  }
+}